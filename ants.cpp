@@ -4,21 +4,62 @@
 	http://www.opensource.org/licenses/mit-license.php
 */
 
+#include <iostream>
 #include "ants.h"
 #include "graph.h"
 
 
-Ant::Ant(int maxLinks)
+void Ant::reset( int maxLinks )
 {
-	workingLinks = new int[ maxLinks ];
-	for (int i=0; i<maxLinks; ++i)
-		workingLinks[i] = 0;
+	links.assign( (maxLinks+63)/64, 0 );
+	cost = 0;
+	latestReliability = -1;
+}
 
+void Ant::setLinkLevel( int link, int level )
+{
+	uint64_t bit = (uint64_t)1 << (link&63);
+	if ( level == getLinkLevel(link) )
+		return;
+	if ( level )
+	{
+		links[link>>6] |= bit;
+		++cost;
+	}
+	else
+	{
+		links[link>>6] &= ~bit;
+		--cost;
+	}
+	latestReliability = -1;
+}
 
-	Graph();
+void Ant::getTopology( const Topology &base, const std::vector<double> &pBase,
+					   Topology *topo, std::vector<double> *p ) const
+{
+	std::vector<int> ends, ids;
+	const int *baseEnds = base.getEnds();
+	p->clear();
+	for ( int k=0; k<base.getNbrEdges(); ++k )
+		if ( getLinkLevel(k) )
+		{
+			ends.push_back( baseEnds[2*k] );
+			ends.push_back( baseEnds[2*k+1] );
+			ids.push_back( base.getEdgeId(k) );
+			p->push_back( pBase[k] );
+		}
+	topo->build( base.getNbrNodes(), ends, ids );
 }
 
-Ant::~Ant()
+void Ant::printEdges( Graph *network ) const
 {
-	delete[] workingLinks;
+	std::cout << "Ant "<<this<<std::endl;
+	std::vector<Edge> &edges = *network->getEdges();
+	for ( size_t k=0; k<edges.size(); ++k )
+		if ( getLinkLevel(k) )
+		{
+			int n0 = edges[k].getConnectingNode();
+			int n1 = edges[k].getConnectingNode(n0);
+			std::cout <<"  "<< n0 << " "<<n1<<" tau: "<<edges[k].getTau(1)/edges[k].getSumTau()<<std::endl;
+		}
 }
@@ -8,27 +8,47 @@
 #define ANTS_H_
 
 #include <vector>
+#include <cstdint>
 #include "graph.h"
 
 
 /** The ant-class is designed for keeping track of the path, cost and reliability
-	of an ant in the network. */
-class Ant : public Graph
+	of an ant in the network. The path is one bit per link of the network, which
+	all ants share, so an ant is small and can be reused for the next solution. */
+class Ant
 {
 public:
+	/** Start a new solution with none of the maxLinks links chosen. The storage is kept. */
+	void reset( int maxLinks );
+
 	/** Set the working level of one of the links. */
-	void setLinkLevel( int link, int level ) {workingLinks[link] = level;};
-	int getLinkLevel(int link) {return workingLinks[link];};
+	void setLinkLevel( int link, int level );
+	int getLinkLevel( int link ) const {return (links[link>>6] >> (link&63)) & 1;};
+
+	/** The chosen links, bit i of word i/64 is link i. */
+	const std::vector<uint64_t>& getLinks() const {return links;};
+
+	/** The cost is the number of chosen links. */
+	int getCost() const {return cost;};
 
+	float getLatestReliability() const {return latestReliability;};
+	void setLatestReliability( float reliability ) {latestReliability = reliability;};
+
+	/** Build the network of the chosen links of base into topo, with their probabilities
+		taken from pBase (indexed like base) into p. */
+	void getTopology( const Topology &base, const std::vector<double> &pBase,
+					  Topology *topo, std::vector<double> *p ) const;
+
+	/** Print the chosen links of network in the format of Graph::printEdges. */
+	void printEdges( Graph *network ) const;
 
 	/** Constructor takes the maximum number of links in the network as argument. */
-	Ant( int maxLinks );
-	~Ant();
+	Ant( int maxLinks=0 ) {reset( maxLinks );};
 
 private:
-	/** An array mapping each link to non-working or working level. */
-	int *workingLinks;
-
+	std::vector<uint64_t> links;	//!< Bit i is set if link i is chosen
+	int cost;
+	float latestReliability;
 };
 
 
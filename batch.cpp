@@ -0,0 +1,244 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include "batch.h"
+#include "graph.h"
+#include "misc.h"
+#include "threadpool.h"
+
+
+/** Apply a setting like samples=1000 to entry. Returns false if it is malformed. */
+static bool parseSetting( const std::string &setting, BatchEntry *entry )
+{
+	size_t equals = setting.find( '=' );
+	if ( equals == std::string::npos )
+		return false;
+	std::string key = setting.substr( 0, equals );
+	std::stringstream value( setting.substr( equals+1 ) );
+
+	bool valid;
+	if ( key == "method" )
+	{
+		std::string method;
+		value >> method;
+		valid = true;
+		if ( method == "auto" )
+			entry->method = BATCH_AUTO;
+		else if ( method == "exact" )
+			entry->method = BATCH_EXACT;
+		else if ( method == "mc" )
+			entry->method = BATCH_MC;
+		else
+			valid = false;
+	}
+	else if ( key == "samples" )
+		valid = (value >> entry->samples) && entry->samples > 0;
+	else if ( key == "probability" )
+		valid = (value >> entry->probability) && entry->probability >= 0 && entry->probability <= 1;
+	else
+		valid = false;
+	return valid && (value >> std::ws).eof();
+}
+
+int readBatchManifest( const char *filename, const BatchEntry &defaults, std::vector<BatchEntry> *entries )
+{
+	std::ifstream file( filename );
+	if ( !file )
+	{
+		std::cout << "Could not open " << filename << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+
+	entries->clear();
+	BatchEntry settings = defaults;
+	std::string line;
+	for ( int lineNumber=1; std::getline( file, line ); ++lineNumber )
+	{
+		std::stringstream words( line );
+		std::string word;
+		if ( !(words >> word) || word[0] == '#' )
+			continue;
+
+		bool set = word == "set";
+		BatchEntry entry = settings;
+		entry.topology = word;
+		bool valid = true;
+		while ( valid && words >> word )
+			valid = parseSetting( word, set ? &settings : &entry );
+		if ( !valid )
+		{
+			std::cout << filename << ":" << lineNumber << ": could not read \"" << word << "\", expected method=auto|exact|mc, samples=<n> or probability=<p>\n";
+			return FILE_OPEN_ERROR;
+		}
+		if ( !set )
+			entries->push_back( entry );
+	}
+	return NO_ERROR;
+}
+
+
+/** What the evaluation of one network gave */
+struct BatchResult
+{
+	int nodes;
+	int edges;
+	double reliability;
+	bool exact;
+	long long samples;
+	double loadSeconds;
+	double evaluationSeconds;
+	std::string error;
+
+	BatchResult() : nodes(0), edges(0), reliability(-1), exact(false), samples(0), loadSeconds(0), evaluationSeconds(0) {};
+};
+
+/** Load the network of entry into network, replacing the one it had */
+static int loadTopology( Graph &network, const BatchEntry &entry )
+{
+	const std::string &name = entry.topology;
+	auto hasExtension = [&]( const std::string &extension ) {
+		return name.size() > extension.size() && name.compare( name.size()-extension.size(), extension.size(), extension ) == 0;
+	};
+
+	LatticeSpec spec;
+	spec.reliability = entry.probability;
+	if ( parseLatticeSpec( name, &spec ) )
+		return network.generateLattice( spec, true );
+	if ( hasExtension( ".nwk" ) )
+		return network.loadEdgeData( name.c_str(), true );
+	if ( hasExtension( ".snapshot" ) )
+		return network.loadSnapshot( name.c_str() );
+	return network.loadEdgeDataFromGraphML( name, entry.probability, true );
+}
+
+/** Load and evaluate entry in network. p is a buffer for the probabilities of the edges. */
+static BatchResult evaluate( Graph &network, const BatchEntry &entry, std::vector<double> &p,
+							 MTRand &rng, int threads )
+{
+	BatchResult result;
+	auto start = std::chrono::steady_clock::now();
+	if ( loadTopology( network, entry ) != NO_ERROR )
+	{
+		result.error = "could not load";
+		return result;
+	}
+	const Topology *topo = network.getTopology();
+	network.getEdgeProbabilities( &p );
+	result.nodes = topo->getNbrNodes();
+	result.edges = topo->getNbrEdges();
+	auto loaded = std::chrono::steady_clock::now();
+	result.loadSeconds = std::chrono::duration<double>( loaded-start ).count();
+
+	if ( entry.method != BATCH_MC )
+	{
+		result.reliability = exactReliability( *topo, p );
+		result.exact = result.reliability >= 0;
+	}
+	if ( !result.exact && entry.method == BATCH_EXACT )
+		result.error = "too large to calculate exactly";
+	else if ( !result.exact )
+	{
+		// One draw seeds the whole simulation, like Graph::estReliabilityMC
+		result.samples = entry.samples;
+		result.reliability = (double)countConnected( *topo, p, entry.samples, rng.randInt(), threads, MC_BITPARALLEL )/entry.samples;
+	}
+	result.evaluationSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now()-loaded ).count();
+	return result;
+}
+
+/** text as a quoted JSON string */
+static std::string jsonString( const std::string &text )
+{
+	std::stringstream quoted;
+	quoted << '"';
+	for ( unsigned char c : text )
+		if ( c == '"' || c == '\\' )
+			quoted << '\\' << c;
+		else if ( c < 0x20 )
+			quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+		else
+			quoted << c;
+	quoted << '"';
+	return quoted.str();
+}
+
+/** text as a CSV field, quoted if it has to be */
+static std::string csvField( const std::string &text )
+{
+	if ( text.find_first_of( ",\"\n" ) == std::string::npos )
+		return text;
+	std::string quoted = "\"";
+	for ( char c : text )
+	{
+		if ( c == '"' )
+			quoted += '"';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+int runBatch( const std::vector<BatchEntry> &entries, const std::string &filename, int threads )
+{
+	std::ofstream file( filename.c_str(), std::ios::out|std::ios::trunc );
+	if ( !file )
+		return FILE_OPEN_ERROR;
+	bool json = (filename.size() > 5 && filename.compare( filename.size()-5, 5, ".json" ) == 0) ||
+				(filename.size() > 6 && filename.compare( filename.size()-6, 6, ".jsonl" ) == 0);
+	file << std::setprecision( 10 );
+	if ( !json )
+		file << "index,topology,method,nodes,edges,reliability,exact,samples,loadSeconds,evaluationSeconds,error" << std::endl;
+
+	// Every thread loads its networks into the same Graph, so the edges, the topology and the
+	// probabilities reuse the memory of the network before. The Monte Carlo simulations get the
+	// threads that have no network of their own.
+	ThreadPool pool( threads );
+	std::vector<Graph> networks( pool.getThreads() );
+	std::vector< std::vector<double> > probabilities( pool.getThreads() );
+	int mcThreads = std::max( 1, pool.getThreads()/std::max( (int)entries.size(), 1 ) );
+	const char *methods[] = { "auto", "exact", "mc" };
+
+	std::cout << "Evaluating " << entries.size() << " networks\n";
+	auto start = std::chrono::steady_clock::now();
+	MTRand::uint32 batchSeed = randomNbrGenerator.randInt();
+	std::mutex fileMutex;
+	int failed = 0;
+	pool.parallelFor( entries.size(), [&]( long long i, int worker )
+	{
+		const BatchEntry &entry = entries[i];
+		MTRand::uint32 key[2] = { batchSeed, (MTRand::uint32)i };
+		MTRand rng( key, 2 );
+		BatchResult r = evaluate( networks[worker], entry, probabilities[worker], rng, mcThreads );
+		const char *method = r.error.empty() ? (r.exact ? "exact" : "mc") : methods[entry.method];
+
+		std::lock_guard<std::mutex> lock( fileMutex );
+		failed += !r.error.empty();
+		if ( json )
+			file << "{\"index\":" << i << ",\"topology\":" << jsonString( entry.topology ) << ",\"method\":\"" << method
+				 << "\",\"nodes\":" << r.nodes << ",\"edges\":" << r.edges << ",\"reliability\":" << r.reliability
+				 << ",\"exact\":" << (r.exact ? "true" : "false") << ",\"samples\":" << r.samples
+				 << ",\"loadSeconds\":" << r.loadSeconds << ",\"evaluationSeconds\":" << r.evaluationSeconds
+				 << ",\"error\":" << jsonString( r.error ) << "}" << std::endl;
+		else
+			file << i << "," << csvField( entry.topology ) << "," << method << "," << r.nodes << "," << r.edges << ","
+				 << r.reliability << "," << r.exact << "," << r.samples << "," << r.loadSeconds << ","
+				 << r.evaluationSeconds << "," << csvField( r.error ) << std::endl;
+	});
+	file.close();
+
+	std::cout << "Wrote " << entries.size() << " results to " << filename << " in "
+			  << std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count() << " s";
+	if ( failed > 0 )
+		std::cout << ", " << failed << " failed";
+	std::cout << std::endl;
+	return file ? NO_ERROR : FILE_OPEN_ERROR;
+}
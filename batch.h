@@ -0,0 +1,59 @@
+/** @file batch.h
+
+	Evaluates the reliability of many networks in a single process.
+
+	The networks are listed in a manifest, one per line, as a file (.nwk, .snapshot or GraphML)
+	or as a lattice spec of generator.h, followed by the settings of that line:
+		# widths of the chain
+		set method=exact probability=0.9
+		chain:10
+		chain:20 method=mc samples=1000000
+		data/10_cell_fc.nwk
+	The settings are method (auto, exact or mc), samples (Monte Carlo samples) and probability
+	(the reliability of the links of lattices and GraphML files). A line starting with set
+	changes the settings of the lines after it. auto calculates the reliability exactly when
+	the network is small enough for exact.h and samples it otherwise. Paths can not contain
+	spaces.
+
+	The networks are loaded and evaluated in parallel on a thread pool, each thread reusing the
+	buffers of its network. Each network has its own random stream seeded from the global
+	generator and its line, so the results only depend on the seed. A result is written as a
+	CSV row, or as a JSON line if the file ends in .json or .jsonl, as soon as it is done, and
+	carries the index of its network in the manifest since they finish in any order.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <vector>
+#include <string>
+
+
+enum batchMethods { BATCH_AUTO, BATCH_EXACT, BATCH_MC };
+
+/** A network of the manifest and how to evaluate it */
+struct BatchEntry
+{
+	std::string topology;		//!< File or lattice spec
+	int method;					//!< One of batchMethods
+	long long samples;			//!< Monte Carlo samples
+	double probability;			//!< Reliability of the links of lattices and GraphML files
+
+	BatchEntry() : method(BATCH_AUTO), samples(100000), probability(0.8) {};
+};
+
+/** Read the manifest filename into entries. The settings start from defaults.
+	Prints the line and returns FILE_OPEN_ERROR if it can not be read or is malformed. */
+int readBatchManifest( const char *filename, const BatchEntry &defaults, std::vector<BatchEntry> *entries );
+
+/** Evaluate entries on threads threads (0 means one per core) and write the results to filename.
+	Returns NO_ERROR, or FILE_OPEN_ERROR if filename can not be written. Networks that can not be
+	loaded or evaluated get a row with the error. */
+int runBatch( const std::vector<BatchEntry> &entries, const std::string &filename, int threads=0 );
+
+
+#endif
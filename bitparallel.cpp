@@ -0,0 +1,113 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <cmath>
+#include <bit>
+#include "bitparallel.h"
+
+
+/** Fill words words with i.i.d. bits that are 1 with probability p.
+	Only the rarer outcome is drawn, by jumping geometrically distributed
+	distances, so a reliable edge costs about one random number per block. */
+static void sampleMask( uint64_t *mask, int words, double p, MTRand &rng )
+{
+	uint64_t base = (p >= 0.5) ? ~0ULL : 0ULL;
+	for ( int w=0; w<words; ++w )
+		mask[w] = base;
+
+	double rare = (p >= 0.5) ? 1-p : p;
+	if ( rare <= 0 )
+		return;
+
+	long long bits = 64LL*words;
+	double invLog = 1.0/std::log( 1-rare );
+	long long pos = -1;
+	while ( true )
+	{
+		// Number of common outcomes before the next rare one
+		if ( rare < 1 )
+			pos += 1 + (long long)( std::log( rng.randDblExc() ) * invLog );
+		else
+			pos += 1;
+		if ( pos >= bits )
+			break;
+		mask[pos>>6] ^= 1ULL << (pos & 63);
+	}
+}
+
+long long countConnectedBitParallel( const Topology &topo, const std::vector<double> &p,
+									 MTRand &rng, int samples, BitScratch &scratch )
+{
+	int nbrNodes = topo.getNbrNodes();
+	int nbrEdges = topo.getNbrEdges();
+	const int *ends = topo.getEnds();
+	int words = (samples + 63)/64;
+	int chunks = (words + MC_LANES - 1)/MC_LANES;
+	int stride = chunks*MC_LANES;
+
+	scratch.edgeMasks.resize( (size_t)nbrEdges*stride );
+	scratch.reach.resize( (size_t)nbrNodes*MC_LANES );
+
+	for ( int k=0; k<nbrEdges; ++k )
+		sampleMask( &scratch.edgeMasks[(size_t)k*stride], stride, p[k], rng );
+
+	long long connected = 0;
+	for ( int c=0; c<chunks; ++c )
+	{
+		// Samples past the end of the block are not counted
+		uint64_t live[MC_LANES];
+		for ( int l=0; l<MC_LANES; ++l )
+		{
+			int first = (c*MC_LANES + l)*64;
+			if ( first + 64 <= samples )
+				live[l] = ~0ULL;
+			else if ( first >= samples )
+				live[l] = 0;
+			else
+				live[l] = (1ULL << (samples-first)) - 1;
+		}
+
+		uint64_t *reach = &scratch.reach[0];
+		for ( int i=0; i<nbrNodes*MC_LANES; ++i )
+			reach[i] = 0;
+		for ( int l=0; l<MC_LANES; ++l )
+			reach[l] = live[l];
+
+		// Spread reachability over the working edges until a fixed point is reached
+		bool changed = true;
+		while ( changed )
+		{
+			changed = false;
+			for ( int k=0; k<nbrEdges; ++k )
+			{
+				const uint64_t *m = &scratch.edgeMasks[(size_t)k*stride + c*MC_LANES];
+				uint64_t *a = reach + ends[2*k]*MC_LANES;
+				uint64_t *b = reach + ends[2*k+1]*MC_LANES;
+				uint64_t diff = 0;
+				for ( int l=0; l<MC_LANES; ++l )
+				{
+					uint64_t both = (a[l] | b[l]) & m[l];
+					diff |= (both & ~a[l]) | (both & ~b[l]);
+					a[l] |= both;
+					b[l] |= both;
+				}
+				if ( diff )
+					changed = true;
+			}
+		}
+
+		// All-terminal: the sample must have reached every node
+		uint64_t all[MC_LANES];
+		for ( int l=0; l<MC_LANES; ++l )
+			all[l] = live[l];
+		for ( int n=0; n<nbrNodes; ++n )
+			for ( int l=0; l<MC_LANES; ++l )
+				all[l] &= reach[n*MC_LANES + l];
+		for ( int l=0; l<MC_LANES; ++l )
+			connected += std::popcount( all[l] );
+	}
+	return connected;
+}
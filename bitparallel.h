@@ -0,0 +1,40 @@
+/** @file bitparallel.h
+
+	Bit-parallel connectivity kernel for the all-terminal Monte Carlo simulation.
+
+	Instead of simulating one sample at a time, bit k of a word holds the state of
+	sample k. Every edge gets a mask of the samples where it works and reachability
+	from node 0 is spread with bitwise AND/OR until nothing changes. MC_LANES words
+	(64 samples each) are processed together, the loops over the lanes are written so
+	that the compiler can turn them into AVX2/AVX-512 instructions when allowed to.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef BITPARALLEL_H_
+#define BITPARALLEL_H_
+
+#include <vector>
+#include <cstdint>
+#include "MersenneTwister.h"
+#include "topology.h"
+
+/** Number of 64 bit words processed in one pass. */
+const int MC_LANES = 4;
+
+/** Buffers used by countConnectedBitParallel, one per thread. */
+struct BitScratch
+{
+	std::vector<uint64_t> edgeMasks;	//!< Working samples of each edge, words per edge after each other
+	std::vector<uint64_t> reach;		//!< Samples where each node is reached from node 0
+};
+
+/** Simulate samples samples where edge k of topo works with probability p[k].
+	Returns the number of samples where all nodes are connected. */
+long long countConnectedBitParallel( const Topology &topo, const std::vector<double> &p,
+									 MTRand &rng, int samples, BitScratch &scratch );
+
+
+#endif
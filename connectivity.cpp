@@ -0,0 +1,114 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include "connectivity.h"
+
+
+void UnionFind::reset( int n )
+{
+	parent.resize( n );
+	rank.resize( n );
+	for ( int i=0; i<n; ++i )
+	{
+		parent[i] = i;
+		rank[i] = 0;
+	}
+	components = n;
+}
+
+bool UnionFind::unite( int a, int b )
+{
+	a = find( a );
+	b = find( b );
+	if ( a == b )
+		return false;
+
+	if ( rank[a] < rank[b] )
+		parent[a] = b;
+	else if ( rank[a] > rank[b] )
+		parent[b] = a;
+	else
+	{
+		parent[b] = a;
+		++rank[a];
+	}
+	--components;
+	return true;
+}
+
+long long countConnectedDFS( const Topology &topo, const std::vector<double> &p,
+							 MTRand &rng, int samples, DfsScratch &scratch )
+{
+	int nbrNodes = topo.getNbrNodes();
+	int nbrEdges = topo.getNbrEdges();
+	const int *neighbors = topo.getNeighbors();
+	const int *adjEdges = topo.getAdjEdges();
+
+	scratch.edgeWorking.resize( nbrEdges );
+	scratch.visited.resize( nbrNodes );
+	scratch.stack.resize( nbrNodes );
+	char *working = scratch.edgeWorking.data();
+	char *visited = scratch.visited.data();
+	int *stack = scratch.stack.data();
+
+	long long connected = 0;
+	for ( int i=0; i<samples; ++i )
+	{
+		// Make some edges fail, with i.i.d. bernoulli-RV's.
+		for ( int k=0; k<nbrEdges; ++k )
+			working[k] = rng() <= p[k];
+
+		for ( int n=0; n<nbrNodes; ++n )
+			visited[n] = 0;
+
+		// Depth first search from node 0 with an explicit stack, every node is pushed once
+		int top = 0, nbrVisited = 1;
+		visited[0] = 1;
+		stack[top++] = 0;
+		while ( top > 0 )
+		{
+			int nc = stack[--top];
+			for ( int j=topo.getOffset(nc); j<topo.getOffset(nc+1); ++j )
+			{
+				int newNode = neighbors[j];
+				if ( working[ adjEdges[j] ] && !visited[newNode] )
+				{
+					visited[newNode] = 1;
+					stack[top++] = newNode;
+					++nbrVisited;
+				}
+			}
+		}
+
+		// Is it a working all-terminal instance? (Are all nodes visited?)
+		if ( nbrVisited == nbrNodes )
+			++connected;
+	}
+	return connected;
+}
+
+long long countConnectedUnionFind( const Topology &topo, const std::vector<double> &p,
+								   MTRand &rng, int samples, UnionFind &uf )
+{
+	int nbrEdges = topo.getNbrEdges();
+	const int *ends = topo.getEnds();
+
+	long long connected = 0;
+	for ( int i=0; i<samples; ++i )
+	{
+		uf.reset( topo.getNbrNodes() );
+
+		// Sample the edges one by one and stop as soon as everything is connected,
+		// the state of the remaining edges does not matter then.
+		for ( int k=0; k<nbrEdges && uf.getComponents() > 1; ++k )
+			if ( rng() <= p[k] )
+				uf.unite( ends[2*k], ends[2*k+1] );
+
+		if ( uf.getComponents() == 1 )
+			++connected;
+	}
+	return connected;
+}
@@ -0,0 +1,74 @@
+/** @file connectivity.h
+
+	Scalar kernels checking if sampled networks are connected, one sample at a time.
+
+	The union-find (disjoint set) structure uses path halving and union by rank,
+	so a sequence of unions and finds is practically linear in the number of edges.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef CONNECTIVITY_H_
+#define CONNECTIVITY_H_
+
+#include <vector>
+#include "MersenneTwister.h"
+#include "topology.h"
+
+
+class UnionFind
+{
+public:
+	UnionFind( int n=0 ) {reset(n);};
+
+	/** Make n singleton components. The storage is kept between calls. */
+	void reset( int n );
+
+	/** Return the representative of the component of x. */
+	int find( int x )
+	{
+		while ( parent[x] != x )
+		{
+			parent[x] = parent[ parent[x] ];
+			x = parent[x];
+		}
+		return x;
+	};
+
+	/** Merge the components of a and b. Returns true if they were separate. */
+	bool unite( int a, int b );
+
+	/** Number of components left. */
+	int getComponents() {return components;};
+
+private:
+	std::vector<int> parent;
+	std::vector<unsigned char> rank;
+	int components;
+};
+
+
+/** Buffers used by countConnectedDFS, one per thread. */
+struct DfsScratch
+{
+	std::vector<char> edgeWorking;
+	std::vector<char> visited;
+	std::vector<int> stack;
+};
+
+/** Simulate samples samples where edge k of topo works with probability p[k] and
+	search the working edges depth first from node 0.
+	Returns the number of samples where all nodes are connected. */
+long long countConnectedDFS( const Topology &topo, const std::vector<double> &p,
+							 MTRand &rng, int samples, DfsScratch &scratch );
+
+/** Simulate samples samples where edge k of topo works with probability p[k] and
+	merge the endpoints of working edges. An edge is only sampled if the network is
+	not already connected. Returns the number of samples where all nodes are connected. */
+long long countConnectedUnionFind( const Topology &topo, const std::vector<double> &p,
+								   MTRand &rng, int samples, UnionFind &uf );
+
+
+#endif
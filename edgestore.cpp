@@ -0,0 +1,128 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <algorithm>
+#include "edgestore.h"
+
+
+int EdgeStore::add( int n1, int n2, double _reliability, float _cost )
+{
+	int id = size();
+	if ( n1 < n2 )
+	{
+		ends.push_back( n1 );
+		ends.push_back( n2 );
+	}
+	else
+	{
+		ends.push_back( n2 );
+		ends.push_back( n1 );
+	}
+	reliability.push_back( _reliability );
+	cost.push_back( _cost );
+	working.push_back( 1 );
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		tau[i].push_back( 1 );
+		deltaTau[i].push_back( 0 );
+	}
+	acoP.push_back( 0 );
+	acoP.push_back( 0 );
+	return id;
+}
+
+void EdgeStore::assign( int n, const int *_ends, const double *_reliability, const float *_cost )
+{
+	ends.resize( 2*n );
+	for ( int id=0; id<n; ++id )
+	{
+		ends[2*id] = std::min( _ends[2*id], _ends[2*id+1] );
+		ends[2*id+1] = std::max( _ends[2*id], _ends[2*id+1] );
+	}
+	reliability.assign( _reliability, _reliability+n );
+	cost.assign( _cost, _cost+n );
+	working.assign( n, 1 );
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		tau[i].assign( n, 1 );
+		deltaTau[i].assign( n, 0 );
+	}
+	acoP.assign( 2*n, 0 );
+}
+
+void EdgeStore::reserve( int n )
+{
+	ends.reserve( 2*n );
+	reliability.reserve( n );
+	cost.reserve( n );
+	working.reserve( n );
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		tau[i].reserve( n );
+		deltaTau[i].reserve( n );
+	}
+	acoP.reserve( 2*n );
+}
+
+void EdgeStore::clear()
+{
+	ends.clear();
+	reliability.clear();
+	cost.clear();
+	working.clear();
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		tau[i].clear();
+		deltaTau[i].clear();
+	}
+	acoP.clear();
+}
+
+void EdgeStore::updateTau( float rho )
+{
+	int n = size();
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		float *t = tau[i].data();
+		float *dt = deltaTau[i].data();
+		for ( int id=0; id<n; ++id )
+		{
+			t[id] = dt[id] + rho*t[id];
+			dt[id] = 0;
+		}
+	}
+}
+
+void EdgeStore::clampTau( float tauMin, float tauMax )
+{
+	int n = size();
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		float *t = tau[i].data();
+		for ( int id=0; id<n; ++id )
+			t[id] = std::min( std::max( t[id], tauMin ), tauMax );
+	}
+}
+
+void EdgeStore::fillTau( float value )
+{
+	int n = size();
+	for ( int i=0; i<maxLevels; ++i )
+		for ( int id=0; id<n; ++id )
+		{
+			tau[i][id] = value;
+			deltaTau[i][id] = 0;
+		}
+}
+
+void EdgeStore::copyTau( const EdgeStore &other )
+{
+	for ( int i=0; i<maxLevels; ++i )
+	{
+		tau[i] = other.tau[i];
+		deltaTau[i] = other.deltaTau[i];
+	}
+}
@@ -0,0 +1,70 @@
+/** @file edgestore.h
+
+	Storage for all the edges of a network as parallel arrays indexed by edge id.
+	Edge objects (graph.h) are only views into an EdgeStore, so loading a network
+	costs a handful of allocations and loops over a property of all edges, like
+	the pheromone update, run over contiguous memory.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef EDGESTORE_H_
+#define EDGESTORE_H_
+
+#include <vector>
+
+
+class EdgeStore
+{
+public:
+	/** How many levels can the links do? Our problem treats binary (on/off). */
+	const static int maxLevels = 2;
+
+	/** Add an edge between n1 and n2 and return its id. The edge starts working
+		with the pheromones reset. */
+	int add( int n1, int n2, double reliability = 0.8, float cost = 1.0 );
+	/** Replace all edges by n edges, edge id between ends[2*id] and ends[2*id+1]. They start
+		working with the pheromones reset, like after add. */
+	void assign( int n, const int *ends, const double *reliability, const float *cost );
+	/** Make room for n edges without reallocating. */
+	void reserve( int n );
+	/** Remove all edges. */
+	void clear();
+	int size() const {return reliability.size();};
+
+	/** The endpoints of edge id are getEnds()[2*id] < getEnds()[2*id+1]. */
+	int* getEnds() {return ends.data();};
+	double* getReliabilities() {return reliability.data();};
+	float* getCosts() {return cost.data();};
+	/** -1 if disabled, 0 if failed and 1 if working */
+	signed char* getWorking() {return working.data();};
+	/** The pheromones of all edges on the chosen level. Level=0 means link is not used. */
+	float* getTau( int level ) {return tau[level].data();};
+	/** The new pheromones, not yet applied */
+	float* getDeltaTau( int level ) {return deltaTau[level].data();};
+	/** getAcoP()[2*id+i] is the probability of edge id to be chosen from its endpoint i */
+	float* getAcoP() {return acoP.data();};
+
+	/** Apply the added deltaTau to all edges, rho decides how fast old trails evaporate. */
+	void updateTau( float rho );
+	/** Keep the pheromones of all levels within [tauMin, tauMax]. */
+	void clampTau( float tauMin, float tauMax );
+	/** Set the pheromones of all levels to tau, the deltaTau are cleared. */
+	void fillTau( float tau );
+	/** Take the pheromones of all levels from another store of the same edges. */
+	void copyTau( const EdgeStore &other );
+
+private:
+	std::vector<int> ends;
+	std::vector<double> reliability;
+	std::vector<float> cost;
+	std::vector<signed char> working;
+	std::vector<float> tau[maxLevels];
+	std::vector<float> deltaTau[maxLevels];
+	std::vector<float> acoP;
+};
+
+
+#endif
@@ -0,0 +1,89 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include "evalcache.h"
+
+
+size_t EvaluationCache::LinksHash::operator()( const std::vector<uint64_t> &links ) const
+{
+	// splitmix64 finalizer on every word, combined like boost::hash_combine
+	uint64_t h = links.size();
+	for ( size_t i=0; i<links.size(); ++i )
+	{
+		uint64_t x = links[i] + 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	}
+	return h;
+}
+
+bool EvaluationCache::find( const std::vector<uint64_t> &links, SolutionEvaluation *evaluation )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	auto it = entries.find( links );
+	if ( it == entries.end() )
+	{
+		++misses;
+		return false;
+	}
+
+	++hits;
+	recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.use );
+	*evaluation = it->second.evaluation;
+	return true;
+}
+
+SolutionEvaluation EvaluationCache::add( const std::vector<uint64_t> &links, const SolutionEvaluation &evaluation )
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	auto it = entries.find( links );
+	if ( it == entries.end() )
+	{
+		if ( entryBytes(links) > maxBytes )
+			return evaluation;
+
+		// Make room by dropping the least recently used sets
+		while ( bytes + entryBytes(links) > maxBytes && !recentlyUsed.empty() )
+		{
+			auto oldest = entries.find( *recentlyUsed.back() );
+			bytes -= entryBytes( oldest->first );
+			recentlyUsed.pop_back();
+			entries.erase( oldest );
+		}
+
+		it = entries.emplace( links, Entry() ).first;
+		recentlyUsed.push_front( &it->first );
+		it->second.use = recentlyUsed.begin();
+		it->second.evaluation = evaluation;
+		bytes += entryBytes( links );
+		return evaluation;
+	}
+
+	recentlyUsed.splice( recentlyUsed.begin(), recentlyUsed, it->second.use );
+	SolutionEvaluation &known = it->second.evaluation;
+	if ( evaluation.exact )
+		known = evaluation;
+	else if ( !known.exact )
+	{
+		known.working += evaluation.working;
+		known.samples += evaluation.samples;
+		if ( known.samples > 0 )
+			known.reliability = (double)known.working/known.samples;
+	}
+	return known;
+}
+
+void EvaluationCache::clear()
+{
+	std::lock_guard<std::mutex> lock( mutex );
+	entries.clear();
+	recentlyUsed.clear();
+	bytes = 0;
+	hits = 0;
+	misses = 0;
+}
@@ -0,0 +1,82 @@
+/** @file evalcache.h
+
+	Memoization of the reliabilities of ACO solutions.
+
+	Once the pheromones converge the ants keep finding the same sets of links. The cache maps
+	a set of links (one bit per link, compared in full, so hash collisions do no harm) to its
+	evaluation. Monte Carlo evaluations of the same set are pooled, which refines the estimate
+	instead of throwing the earlier samples away. The least recently used sets are evicted when
+	the cache grows beyond its memory bound. All functions are thread safe.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef EVALCACHE_H_
+#define EVALCACHE_H_
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+
+/** The reliability of a solution and what it is based on. */
+struct SolutionEvaluation
+{
+	double reliability;		//!< Exact reliability or working/samples
+	long long working;		//!< Working Monte Carlo samples
+	long long samples;		//!< Monte Carlo samples, 0 if exact
+	bool exact;				//!< The reliability was calculated exactly
+
+	SolutionEvaluation() : reliability(-1), working(0), samples(0), exact(false) {};
+};
+
+
+class EvaluationCache
+{
+public:
+	/** A cache using at most about maxBytes bytes. */
+	EvaluationCache( size_t maxBytes=64<<20 ) : maxBytes(maxBytes), bytes(0), hits(0), misses(0) {};
+
+	/** Look up the set of links. Returns true and fills evaluation if it is known.
+		Counts a hit or a miss. */
+	bool find( const std::vector<uint64_t> &links, SolutionEvaluation *evaluation );
+
+	/** Add a new evaluation of the set of links and return what is known now. Exact values
+		replace sampled ones, samples are added to earlier samples of the same set. */
+	SolutionEvaluation add( const std::vector<uint64_t> &links, const SolutionEvaluation &evaluation );
+
+	long long getHits() const {return hits;};
+	long long getMisses() const {return misses;};
+	size_t size() const {std::lock_guard<std::mutex> lock( mutex ); return entries.size();};
+	void clear();
+
+private:
+	struct LinksHash
+	{
+		size_t operator()( const std::vector<uint64_t> &links ) const;
+	};
+	struct Entry
+	{
+		SolutionEvaluation evaluation;
+		std::list<const std::vector<uint64_t>*>::iterator use;
+	};
+
+	/** Memory counted for one entry. */
+	size_t entryBytes( const std::vector<uint64_t> &links ) const {return links.size()*sizeof(uint64_t) + 128;};
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::vector<uint64_t>, Entry, LinksHash> entries;
+	std::list<const std::vector<uint64_t>*> recentlyUsed;	//!< Keys of entries, most recent first
+	size_t maxBytes;
+	size_t bytes;
+	std::atomic<long long> hits;
+	std::atomic<long long> misses;
+};
+
+
+#endif
@@ -0,0 +1,335 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include "exact.h"
+
+
+/** Order the nodes breadth first from node 0, which keeps the frontier of lattices narrow.
+	Returns false if some node can not be reached even with all edges working. */
+static bool breadthFirstOrder( const Topology &topo, std::vector<int> &position )
+{
+	int nbrNodes = topo.getNbrNodes();
+	const int *neighbors = topo.getNeighbors();
+	std::vector<int> queue;
+	queue.reserve( nbrNodes );
+	position.assign( nbrNodes, -1 );
+
+	position[0] = 0;
+	queue.push_back( 0 );
+	for ( int head=0; head<(int)queue.size(); ++head )
+	{
+		int nc = queue[head];
+		for ( int j=topo.getOffset(nc); j<topo.getOffset(nc+1); ++j )
+			if ( position[ neighbors[j] ] < 0 )
+			{
+				position[ neighbors[j] ] = queue.size();
+				queue.push_back( neighbors[j] );
+			}
+	}
+	return (int)queue.size() == nbrNodes;
+}
+
+/** The frontier-based search over all 2^E subgraphs.
+
+	With p given every state carries one probability. Without it a state carries, for each count
+	k of working edges (width E+1), its subgraphs as a share of the C(i,k) subgraphs of the i
+	edges processed so far, which unlike the counts fit in a double for any number of edges.
+	Subgraphs found connected are summed into one, subgraphs found disconnected are summed into
+	zero, which is carried along through the edges after it like a state. */
+static bool frontierSearch( const Topology &topo, const double *p, int maxStates,
+						   std::vector<double> &one, std::vector<double> &zero )
+{
+	int nbrNodes = topo.getNbrNodes();
+	int nbrEdges = topo.getNbrEdges();
+	const int *ends = topo.getEnds();
+	int width = p ? 1 : nbrEdges+1;
+
+	std::vector<int> position;
+	breadthFirstOrder( topo, position );
+
+	std::vector<int> order( nbrEdges );
+	for ( int k=0; k<nbrEdges; ++k )
+		order[k] = k;
+	std::stable_sort( order.begin(), order.end(), [&]( int a, int b ) {
+		int a1 = std::min( position[ends[2*a]], position[ends[2*a+1]] );
+		int b1 = std::min( position[ends[2*b]], position[ends[2*b+1]] );
+		if ( a1 != b1 )
+			return a1 < b1;
+		return std::max( position[ends[2*a]], position[ends[2*a+1]] ) <
+			   std::max( position[ends[2*b]], position[ends[2*b+1]] );
+	} );
+
+	// The step where each node enters and leaves the frontier
+	std::vector<int> first( nbrNodes, nbrEdges ), last( nbrNodes, -1 );
+	for ( int i=0; i<nbrEdges; ++i )
+		for ( int s=0; s<2; ++s )
+		{
+			int n = ends[ 2*order[i]+s ];
+			first[n] = std::min( first[n], i );
+			last[n] = i;
+		}
+
+	// The states of a step are partitions of its frontier. The partitions of w nodes that do not
+	// cross, which is what a planar network can reach, number Catalan(w), so there is no point in
+	// starting when that is more than maxStates at the widest step.
+	std::vector<int> change( nbrEdges+1, 0 );
+	for ( int n=0; n<nbrNodes; ++n )
+		if ( last[n] >= 0 )
+		{
+			++change[ first[n] ];
+			--change[ last[n] ];
+		}
+	int widest = 0;
+	for ( int i=0, w=0; i<nbrEdges; ++i )
+		widest = std::max( widest, w += change[i] );
+	double partitions = 1;
+	for ( int w=0; w<widest && partitions <= maxStates; ++w )
+		partitions *= 2.0*(2*w+1)/(w+2);
+	if ( partitions > maxStates )
+		return false;
+
+	one.assign( width, 0 );
+	zero.assign( width, 0 );
+
+	// A state is the partition of the frontier, node j of the frontier is in component key[j].
+	// All states of a layer share the same frontier.
+	std::vector<int> frontier;
+	std::vector<std::string> keys( 1 );
+	std::vector<double> values( width, 0 );
+	values[0] = 1;
+	int unvisited = nbrNodes;
+
+	std::vector<int> ext, leaving, labels, rename;
+	std::vector<std::string> nextKeys;
+	std::vector<double> nextValues, stay( width ), grow( width );
+	std::unordered_map<std::string, int> index;
+	std::string key;
+
+	for ( int i=0; i<nbrEdges; ++i )
+	{
+		int e = order[i];
+		int u = ends[2*e], v = ends[2*e+1];
+
+		ext = frontier;
+		int nbrOld = ext.size();
+		if ( first[u] == i )
+		{
+			ext.push_back( u );
+			--unvisited;
+		}
+		if ( first[v] == i && v != u )
+		{
+			ext.push_back( v );
+			--unvisited;
+		}
+		int pu = std::find( ext.begin(), ext.end(), u ) - ext.begin();
+		int pv = std::find( ext.begin(), ext.end(), v ) - ext.begin();
+
+		// C(i,k)/C(i+1,k) and C(i,k)/C(i+1,k+1) take the shares with k working edges to edge i+1,
+		// the subgraphs found disconnected before this edge get it as well
+		if ( !p )
+		{
+			for ( int k=0; k<width; ++k )
+			{
+				stay[k] = (double)(i+1-k)/(i+1);
+				grow[k] = (double)(k+1)/(i+1);
+			}
+			for ( int k=std::min( i+1, width-1 ); k>=0; --k )
+				zero[k] = zero[k]*stay[k] + (k > 0 ? zero[k-1]*grow[k-1] : 0);
+		}
+
+		leaving.assign( ext.size(), 0 );
+		frontier.clear();
+		for ( int j=0; j<(int)ext.size(); ++j )
+			if ( last[ ext[j] ] == i )
+				leaving[j] = 1;
+			else
+				frontier.push_back( ext[j] );
+		if ( frontier.size() > 255 )
+			return false;
+
+		nextKeys.clear();
+		nextValues.clear();
+		index.clear();
+		rename.assign( ext.size(), -1 );
+
+		for ( int s=0; s<(int)keys.size(); ++s )
+		{
+			const double *value = &values[ (size_t)s*width ];
+			for ( int works=0; works<2; ++works )
+			{
+				double weight = 1;
+				if ( p )
+				{
+					weight = works ? p[e] : 1-p[e];
+					if ( weight <= 0 )
+						continue;
+				}
+
+				labels.clear();
+				for ( unsigned char c : keys[s] )
+					labels.push_back( c );
+				for ( int j=nbrOld; j<(int)ext.size(); ++j )
+					labels.push_back( j );
+				if ( works && labels[pu] != labels[pv] )
+				{
+					int from = labels[pv];
+					for ( int j=0; j<(int)labels.size(); ++j )
+						if ( labels[j] == from )
+							labels[j] = labels[pu];
+				}
+
+				// Canonical key of the nodes staying, numbered in order of first appearance
+				int nbrLabels = 0;
+				key.clear();
+				for ( int j=0; j<(int)ext.size(); ++j )
+					if ( !leaving[j] )
+					{
+						if ( rename[ labels[j] ] < 0 )
+							rename[ labels[j] ] = nbrLabels++;
+						key.push_back( (char)rename[ labels[j] ] );
+					}
+
+				// A component whose nodes all leave the frontier will never grow again
+				int closed = 0;
+				for ( int j=0; j<(int)ext.size(); ++j )
+					if ( leaving[j] && rename[ labels[j] ] < 0 )
+					{
+						rename[ labels[j] ] = nbrLabels++;
+						++closed;
+					}
+				for ( int j=0; j<(int)ext.size(); ++j )
+					rename[ labels[j] ] = -1;
+
+				double *target;
+				if ( closed == 0 )
+				{
+					auto found = index.find( key );
+					if ( found == index.end() )
+					{
+						if ( (int)nextKeys.size() >= maxStates )
+							return false;
+						found = index.emplace( key, nextKeys.size() ).first;
+						nextKeys.push_back( key );
+						nextValues.resize( nextValues.size()+width, 0 );
+					}
+					target = &nextValues[ (size_t)found->second*width ];
+				}
+				else if ( closed == 1 && frontier.empty() && unvisited == 0 )
+					target = one.data();
+				else
+					target = zero.data();
+
+				if ( p )
+					target[0] += weight*value[0];
+				else
+				{
+					const double *share = works ? grow.data() : stay.data();
+					for ( int k=0; k<=i && k+works<width; ++k )
+						target[k+works] += value[k]*share[k];
+				}
+			}
+		}
+		keys.swap( nextKeys );
+		values.swap( nextValues );
+	}
+	return true;
+}
+
+
+bool ReliabilityPolynomial::compute( const Topology &topo, int maxStates )
+{
+	int nbrEdges = topo.getNbrEdges();
+	connected.assign( nbrEdges+1, 0 );
+	disconnected.assign( nbrEdges+1, 0 );
+
+	std::vector<int> position;
+	bool spanning = topo.getNbrNodes() > 0 && breadthFirstOrder( topo, position );
+
+	if ( nbrEdges == 0 || !spanning )
+	{
+		if ( spanning && topo.getNbrNodes() == 1 )
+			connected.assign( nbrEdges+1, 1 );
+		else
+			disconnected.assign( nbrEdges+1, 1 );
+		return true;
+	}
+
+	if ( !frontierSearch( topo, 0, maxStates, connected, disconnected ) )
+		return false;
+
+	// The shares are at most 1, anything else means the search went wrong and the caller
+	// should fall back to sampling
+	for ( int k=0; k<=nbrEdges; ++k )
+		if ( !std::isfinite( connected[k] ) || !std::isfinite( disconnected[k] ) )
+			return false;
+	return true;
+}
+
+void ReliabilityPolynomial::setConnectedFractions( const std::vector<double> &fractions )
+{
+	connected = fractions;
+	disconnected.resize( fractions.size() );
+	for ( size_t k=0; k<fractions.size(); ++k )
+		disconnected[k] = 1-fractions[k];
+}
+
+double ReliabilityPolynomial::reliabilityAfterRemoving( int removed, double p ) const
+{
+	return evaluate( connected, std::max( 0, getNbrEdges()-removed ), p );
+}
+
+double ReliabilityPolynomial::evaluate( const std::vector<double> &shares, int n, double p ) const
+{
+	if ( n < 0 || (int)shares.size() <= n )
+		return 0;
+	if ( p <= 0 )
+		return shares[0];
+	if ( p >= 1 )
+		return shares[n];
+
+	// The binomial probabilities in logarithms, from P(0) = (1-p)^n by the ratio of neighbours.
+	// Neither they nor C(n,k) alone fit in a double for large n.
+	double logRatio = std::log( p ) - std::log1p( -p );
+	double logTerm = n*std::log1p( -p );
+	double sum = 0;
+	for ( int k=0; k<=n; ++k )
+	{
+		if ( shares[k] > 0 )
+			sum += std::exp( logTerm )*shares[k];
+		logTerm += std::log( (double)(n-k)/(k+1) ) + logRatio;
+	}
+	return sum;
+}
+
+
+double exactReliability( const Topology &topo, const std::vector<double> &p, double *unreliability,
+						 int maxStates )
+{
+	double r = 0, u = 1;
+	std::vector<int> position;
+	if ( topo.getNbrNodes() == 1 )
+	{
+		r = 1;
+		u = 0;
+	}
+	else if ( topo.getNbrNodes() > 1 && breadthFirstOrder( topo, position ) )
+	{
+		std::vector<double> one, zero;
+		if ( !frontierSearch( topo, p.data(), maxStates, one, zero ) )
+			return -1;
+		r = one[0];
+		u = zero[0];
+	}
+
+	if ( unreliability )
+		*unreliability = u;
+	return r;
+}
@@ -0,0 +1,73 @@
+/** @file exact.h
+
+	Exact all-terminal reliability with a frontier-based search, the dynamic programming
+	behind the decision diagrams of Hardy, Lucet and Limnios.
+
+	Nodes are numbered by a breadth first search from node 0 and the edges are processed in
+	that order. After each edge only the nodes still having unprocessed edges (the frontier)
+	matter, and subgraphs with the same partition of the frontier into components are merged.
+	The work grows with the number of partitions of the frontier, which stays small for the
+	lattices in data/ but explodes on dense networks, so the search gives up at a state limit.
+	It does not even start when the widest frontier has more partitions that do not cross than
+	the limit, which turns down the large lattices in no time instead of after the full limit.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef EXACT_H_
+#define EXACT_H_
+
+#include <vector>
+#include "topology.h"
+
+/** Default limit on the number of frontier states kept at the same time. */
+const int EXACT_MAX_STATES = 1000000;
+
+
+/** The all-terminal reliability polynomial of a network where every edge works with the
+	same probability p: R(p) = sum_k N_k p^k (1-p)^(E-k) where N_k is the number of connected
+	spanning subgraphs with k edges. The disconnected subgraphs F_k are counted separately,
+	which keeps 1-R accurate when it is tiny. Beyond about 1030 edges the counts do not fit in
+	a double, so the shares N_k/C(E,k) and F_k/C(E,k) of the subgraphs with k edges are kept
+	instead and R(p) is summed as the binomial mixture of the shares. */
+class ReliabilityPolynomial
+{
+public:
+	/** Compute the coefficients for topo. Returns false if more than maxStates states were needed. */
+	bool compute( const Topology &topo, int maxStates=EXACT_MAX_STATES );
+	/** Set the coefficients of a network with E=fractions.size()-1 edges where the share
+		fractions[k] of the subgraphs with k edges is connected, e.g. estimated by sampling. */
+	void setConnectedFractions( const std::vector<double> &fractions );
+
+	double reliability( double p ) const {return evaluate( connected, getNbrEdges(), p );};
+	double unreliability( double p ) const {return evaluate( disconnected, getNbrEdges(), p );};
+	/** Expected reliability when removed edges chosen at random are taken out and the others work
+		with probability p. The working edges are then a uniformly chosen subset of each size k,
+		so this is the binomial mixture of the connected shares over k. */
+	double reliabilityAfterRemoving( int removed, double p ) const;
+
+	/** N_k/C(E,k), the share of the spanning subgraphs with k edges that is connected. */
+	const std::vector<double>& getConnectedShares() const {return connected;};
+	/** F_k/C(E,k), the share of the spanning subgraphs with k edges that is disconnected. */
+	const std::vector<double>& getDisconnectedShares() const {return disconnected;};
+	int getNbrEdges() const {return (int)connected.size()-1;};
+
+private:
+	/** sum_k shares[k] P(Binomial(n,p)=k) for k=0..n */
+	double evaluate( const std::vector<double> &shares, int n, double p ) const;
+
+	std::vector<double> connected;
+	std::vector<double> disconnected;
+};
+
+
+/** Exact reliability of topo where edge k works with probability p[k].
+	The unreliability is computed directly as well (not as 1-R) and stored in unreliability if given.
+	Returns -1 if more than maxStates states were needed. */
+double exactReliability( const Topology &topo, const std::vector<double> &p, double *unreliability=0,
+						 int maxStates=EXACT_MAX_STATES );
+
+
+#endif
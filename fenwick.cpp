@@ -0,0 +1,69 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <algorithm>
+#include "fenwick.h"
+
+
+void FenwickTree::build( const std::vector<double> &weights )
+{
+	int n = weights.size();
+	weight.resize( n );
+	tree.assign( n, 0 );
+	total = 0;
+	for ( int i=0; i<n; ++i )
+	{
+		weight[i] = weights[i] > 0 ? weights[i] : 0;
+		total += weight[i];
+	}
+
+	// Linear time construction, every node passes its sum on to its parent
+	for ( int i=1; i<=n; ++i )
+	{
+		tree[i-1] += weight[i-1];
+		int parent = i + (i & -i);
+		if ( parent <= n )
+			tree[parent-1] += tree[i-1];
+	}
+
+	highBit = 1;
+	while ( 2*highBit <= n )
+		highBit *= 2;
+}
+
+void FenwickTree::add( int i, double delta )
+{
+	weight[i] += delta;
+	total += delta;
+	for ( int j=i+1; j<=(int)tree.size(); j += j & -j )
+		tree[j-1] += delta;
+}
+
+int FenwickTree::find( double u ) const
+{
+	int n = weight.size();
+	if ( n == 0 || total <= 0 )
+		return -1;
+
+	// Walk down the implicit tree, pos is the number of items known to lie before u
+	int pos = 0;
+	for ( int step=highBit; step>0; step /= 2 )
+		if ( pos+step <= n && tree[pos+step-1] <= u )
+		{
+			pos += step;
+			u -= tree[pos-1];
+		}
+
+	// Rounding in the sums can make u land on a removed item or past the end,
+	// take the nearest item still on the wheel then
+	for ( int i=pos; i<n; ++i )
+		if ( weight[i] > 0 )
+			return i;
+	for ( int i=std::min( pos, n )-1; i>=0; --i )
+		if ( weight[i] > 0 )
+			return i;
+	return -1;
+}
@@ -0,0 +1,47 @@
+/** @file fenwick.h
+
+	Roulette-wheel selection with a Fenwick (binary indexed) tree.
+
+	Item i is drawn with probability proportional to its weight, and drawn items can be taken
+	out of the wheel. Both take O(log n), so picking k items out of n costs O(n + k log n)
+	however small the weights are.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef FENWICK_H_
+#define FENWICK_H_
+
+#include <vector>
+
+
+class FenwickTree
+{
+public:
+	/** Put the items 0..weights.size()-1 on the wheel. Negative weights count as 0. */
+	void build( const std::vector<double> &weights );
+
+	/** Change the weight of item i by delta. */
+	void add( int i, double delta );
+	/** Take item i off the wheel. */
+	void remove( int i ) {if ( weight[i] > 0 ) add( i, -weight[i] ); weight[i] = 0;};
+
+	double getWeight( int i ) const {return weight[i];};
+	/** Sum of the weights on the wheel. */
+	double getTotal() const {return total;};
+	int size() const {return weight.size();};
+
+	/** The item where u in [0,getTotal()) falls on the wheel, -1 if all weights are 0. */
+	int find( double u ) const;
+
+private:
+	std::vector<double> tree;		//!< tree[i-1] is the sum of the weights of the range ending at item i-1
+	std::vector<double> weight;
+	double total;
+	int highBit;					//!< Largest power of two not above the size
+};
+
+
+#endif
@@ -1,8 +1,12 @@
-#! /usr/bin/python
+#!/usr/bin/env python3
 #
 #	Script for finding good parameters for ACO. Saves the result in 
 # 	in text files that can be loaded and plotted from the Matlab-script
 #	with the same name.
+#
+#	All runs are made by the sweep mode of the main program, which loads the
+#	network once and spreads the runs over all cores. This script only sets up
+#	the grid and turns the rows of the sweep into the matrices Rmean and Rmax.
 #	
 #	Copyright (c) 2010 Anders Bennehag
 #	Licensed under the MIT license
@@ -10,7 +14,7 @@
 #
 import sys
 import subprocess
-import re
+import csv
 
 
 
@@ -20,54 +24,36 @@ K = range(10, 31,10)
 Ants = range(10,51,10)
 iterations = 5
 network = 'data/10_cell_fc.nwk'
+probability = '0.8'
 cost = '41'
-cores = 2;
+sweepFile = 'sweep.csv'
+
+
+def commaList(values):
+	return ','.join([str(v) for v in values])
 
+subprocess.check_call(['./AntOptimization', '-pathMl', network, '-probability', probability,
+	'-maxCost', cost, '-Nmax', str(K[0]), '-nbrAnts', str(Ants[0]),
+	'-sweep', sweepFile, '-sweepNmax', commaList(K), '-sweepAnts', commaList(Ants),
+	'-repetitions', str(iterations)])
 
-# Open the files for reading
+# One row per combination of K and ants
+Rmean = {}
+Rmax = {}
+for row in csv.DictReader(open(sweepFile)):
+	key = (int(row['Nmax']), int(row['nbrAnts']))
+	Rmean[key] = row['Rmean']
+	Rmax[key] = row['Rmax']
+
+# Open the files for writing
 fmean = open('Rmean.txt','w')
 fmax = open('Rmax.txt','w')
 
-i=0
 for k in K:
 	for a in Ants:
-		Rarr = []
-		print 'Starting k='+str(k)+' and a='+str(a),
-			
-		for j in range(0,iterations,cores):
-				
-			# Just a counter
-			i=i+1		
-			
-			# Run the simulation on both cores
-			subproc = []
-			for core in range(0,cores):
-				sp = subprocess.Popen(['./main', '-f', network, '-aco', str(cost), str(k), str(a)], stdout=subprocess.PIPE)
-				
-				subproc.append(sp)
-				
-			for core in range(0,cores):
-				subproc[core].wait()
-				data = subproc[core].communicate()
-				output = data[0]
-
-				# Get the reliability with regexp
-				p = re.compile('^All-terminal reliability = (0.\d*)', re.MULTILINE)
-				m = re.search(p, output)
-				R = float(m.group(1))
-				Rarr.append(R)
-			
-			#print '.',#+str(i),
-		Rmean = 0
-		Rmax = 0
-		for R in Rarr:
-			Rmean += R/len(Rarr)
-			if R>Rmax:
-				Rmax = R
-		#print 'For k='+str(k)+', ants='+str(a)+': 
-		print 'Rmax = '+str(Rmax)+', Rmean = '+str(Rmean)
-		fmean.write(str(Rmean)+' ')
-		fmax.write(str(Rmax)+' ')
+		print('For k='+str(k)+', ants='+str(a)+': Rmax = '+Rmax[(k,a)]+', Rmean = '+Rmean[(k,a)])
+		fmean.write(Rmean[(k,a)]+' ')
+		fmax.write(Rmax[(k,a)]+' ')
 
 	fmean.write('\n')
 	fmax.write('\n')
@@ -75,4 +61,4 @@ for k in K:
 fmean.close()
 fmax.close()
 		
-print "Mean values averaged over "+str(iterations*cores)+" iterations"		
+print("Mean values averaged over "+str(iterations)+" iterations")
@@ -0,0 +1,108 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <sstream>
+#include <climits>
+#include "generator.h"
+
+
+bool parseLatticeSpec( const std::string &text, LatticeSpec *spec )
+{
+	std::stringstream stream( text );
+	std::string item;
+	if ( !std::getline( stream, item, ':' ) )
+		return false;
+	if ( item == "chain" )
+		spec->type = LATTICE_CHAIN;
+	else if ( item == "ring" || item == "cylinder" )
+		spec->type = LATTICE_CYLINDER;
+	else if ( item == "toroid" )
+		spec->type = LATTICE_TOROID;
+	else
+		return false;
+
+	// cells wide, optionally x cells high
+	if ( !std::getline( stream, item, ':' ) )
+		return false;
+	std::stringstream size( item );
+	char x;
+	spec->cellsHigh = 1;
+	if ( !(size >> spec->cellsWide) || spec->cellsWide < 1 )
+		return false;
+	if ( size >> x && (x != 'x' || !(size >> spec->cellsHigh) || spec->cellsHigh < 1 || !(size >> std::ws).eof()) )
+		return false;
+
+	spec->rotated = false;
+	spec->fullyConnected = false;
+	while ( std::getline( stream, item, ':' ) )
+		if ( item == "rot" )
+			spec->rotated = true;
+		else if ( item == "fc" )
+			spec->fullyConnected = true;
+		else
+			return false;
+	return true;
+}
+
+std::string latticeName( const LatticeSpec &spec )
+{
+	std::stringstream name;
+	const char *types[] = { "chain", "cylinder", "toroid" };
+	name << types[spec.type] << ":" << spec.cellsWide << "x" << spec.cellsHigh;
+	if ( spec.rotated )
+		name << ":rot";
+	if ( spec.fullyConnected )
+		name << ":fc";
+	return name.str();
+}
+
+int generateLattice( const LatticeSpec &spec, std::vector<int> *ends )
+{
+	int W = spec.cellsWide, H = spec.cellsHigh;
+	bool joinSides = spec.type != LATTICE_CHAIN;
+	bool joinEnds = spec.type == LATTICE_TOROID;
+	ends->clear();
+	if ( W < (joinSides ? 2 : 1) || H < (joinEnds ? 2 : 1) || 8LL*(W+1)*(H+1) > INT_MAX )
+		return 0;
+
+	// The joined border and row are numbered as the ones they are joined to
+	int columns = joinSides ? W : W+1;
+	int rows = joinEnds ? H : H+1;
+	auto node = [&]( int row, int col ) {
+		if ( joinSides && col == W )
+		{
+			col = 0;
+			if ( spec.rotated )
+				row = H-row;
+		}
+		if ( joinEnds && row == H )
+			row = 0;
+		return row*columns + col;
+	};
+	auto link = [&]( int n1, int n2 ) {
+		ends->push_back( n1 );
+		ends->push_back( n2 );
+	};
+
+	// Horizontal sides, diagonals and at most every vertical side
+	ends->reserve( 2*((size_t)W*(H+1) + 2*(size_t)W*H + (size_t)(W+1)*H) );
+	for ( int row=0; row<=H; ++row )
+		for ( int col=0; col<=W; ++col )
+		{
+			bool firstCol = col == 0, lastCol = col == W;
+			if ( !firstCol && !(joinEnds && row == H) )
+				link( node(row, col-1), node(row, col) );		// west
+			if ( row == 0 )
+				continue;
+			if ( !firstCol )
+				link( node(row-1, col-1), node(row, col) );		// south west
+			if ( joinSides ? firstCol || (!lastCol && spec.fullyConnected) : firstCol || lastCol || spec.fullyConnected )
+				link( node(row-1, col), node(row, col) );		// south
+			if ( !lastCol )
+				link( node(row, col), node(row-1, col+1) );		// south east
+		}
+	return rows*columns;
+}
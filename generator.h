@@ -0,0 +1,56 @@
+/** @file generator.h
+
+	Generates the lattices that generateNetwork.py used to write as .nwk files.
+
+	A lattice is cellsWide x cellsHigh square cells whose corners are the nodes. Every cell has
+	both diagonals, and the horizontal sides are always links. The vertical sides are only
+	links on the left and right borders, unless the lattice is fully connected. Nodes are
+	numbered row by row from the lower left corner, like this chain of two cells:
+		3 4 5
+		0 1 2
+	A cylinder (or ring) joins the right border to the left border, and if it is rotated row r
+	of the right border is joined to row cellsHigh-r of the left border. A toroid is a cylinder
+	whose top row is also joined to its bottom row.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <vector>
+#include <string>
+
+
+enum latticeTypes { LATTICE_CHAIN, LATTICE_CYLINDER, LATTICE_TOROID };
+
+/** What lattice to generate */
+struct LatticeSpec
+{
+	int type;				//!< One of latticeTypes
+	int cellsWide;
+	int cellsHigh;
+	bool rotated;			//!< The border of a cylinder or toroid is joined upside down
+	bool fullyConnected;	//!< All vertical sides are links, not only the borders
+	double reliability;		//!< Of every link
+
+	LatticeSpec() : type(LATTICE_CHAIN), cellsWide(1), cellsHigh(1), rotated(false), fullyConnected(false), reliability(0.8) {};
+};
+
+/** Parse a spec like "chain:10", "ring:10x2:rot" or "toroid:100x100:fc", where the type is chain,
+	ring, cylinder or toroid, the size is cells wide x cells high (default 1 high) and the optional
+	flags are rot and fc. The reliability is not changed. Returns false if it is malformed. */
+bool parseLatticeSpec( const std::string &text, LatticeSpec *spec );
+
+/** The spec in the form parseLatticeSpec reads */
+std::string latticeName( const LatticeSpec &spec );
+
+/** Fill ends with the nodes of the links of the lattice, link k is ends[2k]-ends[2k+1], in the
+	order generateNetwork.py wrote them. Returns the number of nodes, or 0 if the lattice is too
+	large or too small to join its borders (cylinders need 2 cells wide, toroids also 2 high). */
+int generateLattice( const LatticeSpec &spec, std::vector<int> *ends );
+
+
+#endif
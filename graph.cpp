@@ -14,11 +14,25 @@
 #include <list>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
 
 #include "misc.h"
 #include "graph.h"
 #include "MersenneTwister.h"
 #include "ants.h"
+#include "montecarlo.h"
+#include "rareevent.h"
+#include "threadpool.h"
+#include "evalcache.h"
+#include "fenwick.h"
+#include "mappedfile.h"
+#include "graphml.h"
+#include "snapshot.h"
 #include <variant>
 ////////////////////////////////////////////////////////////
 //
@@ -27,95 +41,56 @@
 ////////////////////////////////////////////////////////////
 
 
-Edge::Edge( int n1, int n2, float _reliability, float _cost )
-{
-	if (n1<n2)
-	{
-		n[0] = n1;
-		n[1] = n2;
-	}
-	else
-	{
-		n[0] = n2;
-		n[1] = n1;
-	}
-	std::variant<int> hello;
-    reliability = _reliability;
-    cost = _cost;
-    working = true;
-
-	tau = new float[maxLevels];
-    for ( int i=0; i<maxLevels; ++i )
-    {
-		tau[i] = 1;
-    }
-	//std::cout << "Calling edge constructor... " << this<< " "<<acoTau[0]<<" "<<acoTau[1]<<std::endl;
-	deltaTau = new float[maxLevels];
-    for ( int i=0; i<maxLevels; ++i )
-    {
-		deltaTau[i] = 0;
-    }
-
-}
 void Edge::setTau(int level, float _tau )
 {
 	if (level>=maxLevels)
 		throw "level is too big in setTau";
-	tau[level] = _tau;
+	store->getTau(level)[id] = _tau;
 
 
 }
 
 void Edge::addDeltaTau(int level, float _deltaTau)
 {
-	deltaTau[level] += _deltaTau;
+	store->getDeltaTau(level)[id] += _deltaTau;
 }
 void Edge::updateTau(float rho)
 {
 	for ( int i=0; i<maxLevels; ++i )
-		tau[i] = deltaTau[i] + rho*tau[i];
+		store->getTau(i)[id] = store->getDeltaTau(i)[id] + rho*store->getTau(i)[id];
 	for ( int i=0; i<maxLevels; ++i )
-		deltaTau[i] =0;
+		store->getDeltaTau(i)[id] =0;
 
 }
 
 void Edge::reset()
 {
 
-	cost=1;
-	if ( working >= 0 )
-		working = 1;
+	if ( !isDisabled() )
+		store->getWorking()[id] = 1;
 }
 void Edge::hardReset()
 {
 	for ( int i=0; i<maxLevels; ++i )
 	{
-		tau[i] = 1;
+		store->getTau(i)[id] = 1;
 	}
 	for ( int i=0; i<maxLevels; ++i )
 	{
-		deltaTau[i] = 0;
+		store->getDeltaTau(i)[id] = 0;
 	}
 
-	 working=1;
+	store->getWorking()[id]=1;
 	reset();
 }
-float Edge::getSumTau()
+float Edge::getSumTau() const
 {
 	float sum=0;
 	for (int i=0; i<maxLevels; ++i)
-		sum += tau[i];
+		sum += store->getTau(i)[id];
 	return sum;
 }
 
-Edge::~Edge()
-{
-	delete[] tau;
-	tau =0;
-	delete[] deltaTau;
-	deltaTau=0;
-}
-
 ////////////////////////////////////////////////////////////
 //
 //      The GRAPH class
@@ -123,38 +98,47 @@ Edge::~Edge()
 ////////////////////////////////////////////////////////////
 
 
-int Graph::biggestNodeId = 0;
+int Graph::nbrThreads = defaultThreadCount();
+
+void Graph::setThreads( int threads )
+{
+	if ( threads < 1 )
+		threads = defaultThreadCount();
+	nbrThreads = threads;
+}
 
 void Graph::setEdgeReliability( double newReliability )
 {
-	std::vector<Edge*>::iterator it;
+	std::vector<Edge>::iterator it;
 		for ( it = edges.begin(); it < edges.end() ; ++it )
-			(*it)->setReliability( newReliability );
+			it->setReliability( newReliability );
 }
 
-int Graph::addEdge( Edge *e )
+int Graph::addEdge( Edge e )
 {
-
-
-	// Dont forget to initialize connectingEdges if this is a new graph
-	// Use the static biggestNodeId as size (loadEdgeData has to be called first).
-	if ( connectingEdges == 0 )
-		connectingEdges = new std::vector<Edge*>[biggestNodeId+1];
-
 	// Check so that e does not already exist in the list
-	std::vector<Edge*>::iterator it;
+	std::vector<Edge>::iterator it;
 	for ( it = edges.begin(); it != edges.end(); ++it)
 		if ( *it == e )
 			return 1;
 
 	edges.push_back( e );
-	const int *n = e->getNodes();
-	int n0 = n[0], n1 = n[1];
-	connectingEdges[n[0]].push_back(e);
-	connectingEdges[n[1]].push_back(e);
+	const int *n = e.getNodes();
+	if ( std::max( n[0], n[1] ) > biggestNodeId )
+	{
+		// connectingEdges is rebuilt with room for the new nodes when it is asked for
+		biggestNodeId = std::max( n[0], n[1] );
+		cleanup();
+	}
+	else if ( connectingEdges != 0 )
+	{
+		connectingEdges[n[0]].push_back(e);
+		connectingEdges[n[1]].push_back(e);
+	}
 
 	// Network has changed, the estimated reliability does not apply anymore
 	latestEstimatedReliability = -1;
+	topologyValid = false;
 	return 0;
 }
 
@@ -165,18 +149,18 @@ void Graph::disableXEdges( unsigned int F )
 		F = edges.size();
 
 	// First reset the edges
-	std::vector<Edge*>::iterator it;
+	std::vector<Edge>::iterator it;
 	for ( it = edges.begin(); it < edges.end() ; ++it )
-			(*it)->reset();
+			it->reset();
 
 
 	//std::cout << "F="<<F << std::endl;
 	while ( F > 0 )
 	{
 		int r = randomNbrGenerator.randExc( edges.size());
-		if ( edges[r]->isWorking() )
+		if ( edges[r].isWorking() )
 		{
-			edges[r]->disable();
+			edges[r].disable();
 			--F;
 		}
 
@@ -185,103 +169,231 @@ void Graph::disableXEdges( unsigned int F )
 
 void Graph::hardResetEdges()
 {
-	std::vector<Edge*>::iterator it;
+	std::vector<Edge>::iterator it;
 	for ( it = edges.begin(); it != edges.end() ; ++it )
-		(*it)->hardReset();
+		it->hardReset();
 
 }
 
 
-float Graph::estReliabilityMC( int t, bool rawFormat)
+float Graph::estReliabilityMC( int t, bool rawFormat, int mode, int threads, MTRand *rng )
 {
-	// TODO, implement threading of this part? If so, make copies of connectedEdges (REAL COPIES, not just the pointers)
+	if ( threads <= 0 )
+		threads = nbrThreads;
+
+	std::vector<double> p;
+	getEdgeProbabilities( &p );
 
+	// One draw from the global generator seeds the whole simulation, which keeps
+	// runs reproducible from the seed of randomNbrGenerator.
+	if ( !rng )
+		rng = &randomNbrGenerator;
+	MTRand::uint32 seed = rng->randInt();
+	long long workingAllTerminalNetworks = countConnected( *getTopology(), p, t, seed, threads, mode );
 
-	int workingAllTerminalNetworks=0;
-	for ( int i=0;i<t; ++i )
+	if ( rawFormat )
 	{
-		// Reset all edges to working state
-		std::vector<Edge*>::iterator it;
-		for ( it = edges.begin(); it != edges.end() ; ++it )
-		{
-			(*it)->reset();
-		}
-		// Make some edges fail, with i.i.d. bernoulli-RV's.
-		for ( it = edges.begin(); it != edges.end() ; ++it )
-		{
-			if ( randomNbrGenerator() > (*it)->getReliability() )
-			{
-				// This link failed!
-				(*it)->setWorking( 0 );
-			}
-		}
+		//std::cout << (float)(workingAllTerminalNetworks)/t << " ";
+
+	}
+	else
+	{
+		std::cout << "All-terminal reliability = " << (float)(workingAllTerminalNetworks)/t  << ", calculated from "<< t <<" simulations\n";
+	}
+
+	latestEstimatedReliability = (float)workingAllTerminalNetworks/t;
+	return latestEstimatedReliability;
+}
+
+ReliabilityEstimate Graph::estReliabilitySequential( double relHalfWidth, double confidence, int relativeTo,
+													  long long maxSamples, bool rawFormat, int mode, int threads )
+{
+	if ( threads <= 0 )
+		threads = nbrThreads;
 
-		// Keep an array for all visited nodes.
+	std::vector<double> p;
+	getEdgeProbabilities( &p );
+	const Topology *topo = getTopology();
 
-		std::vector<bool> nodeVisited(biggestNodeId+1);
-		
-		for ( int i=0; i<=biggestNodeId; ++i )
+	long long n = 0, working = 0;
+	long long batch = 16*MC_BLOCK_SIZE;
+	ReliabilityEstimate est = wilsonInterval( 0, 0, confidence );
+	while ( n < maxSamples )
+	{
+		if ( batch > maxSamples-n )
+			batch = maxSamples-n;
+
+		// Every batch is seeded from the global generator, like estReliabilityMC
+		MTRand::uint32 seed = randomNbrGenerator.randInt();
+		working += countConnected( *topo, p, batch, seed, threads, mode );
+		n += batch;
+
+		est = wilsonInterval( working, n, confidence );
+		bool failures = relativeTo == RELATIVE_TO_UNRELIABILITY || (relativeTo == RELATIVE_TO_SMALLER && 2*working > n);
+		long long hits = failures ? n-working : working;
+		double reference = (double)hits/n;
+		double halfWidth = (est.upper-est.lower)/2;
+		if ( hits > 0 && halfWidth <= relHalfWidth*reference )
+			break;
+
+		// Nothing seen on the reference side, the bound of the rule of three falls as 1/n
+		double zeroBound = -std::log( 1-confidence );
+		if ( hits == 0 && zeroBound/n <= relHalfWidth )
+			break;
+
+		// Guess the total number of samples from the variance of a binomial,
+		// but never more than doubling the samples in one step.
+		double needed = zeroBound/relHalfWidth;
+		if ( hits > 0 )
 		{
-			nodeVisited[i] = false;
+			double z = normalQuantile( 0.5 + confidence/2 );
+			needed = z*z*(1-reference)/(reference*relHalfWidth*relHalfWidth);
 		}
+		batch = std::min( (long long)needed - n, n );
+		if ( batch < MC_BLOCK_SIZE )
+			batch = MC_BLOCK_SIZE;
+	}
 
-		// Basic failsafe
-		/*if ( n1>biggestNodeId || n1<0 || n2>network->getBiggestNodeId() || n2<0 )
-		{
-			std::cout << "In estReliabilityMC: Illegal node-id.\n\tAborting\n";
-			return ILLEGAL_NODE_ID;
-		}*/
+	if ( !rawFormat )
+	{
+		std::cout << "All-terminal reliability = " << est.estimate << ", " << 100*confidence << "% interval ["
+				  << est.lower << ", " << est.upper << "], calculated from " << n << " simulations\n";
+	}
 
-		// Is this a working two-terminal instance of the problem?
-		int result = unfoldGraph( 0, connectingEdges,&nodeVisited );
+	latestEstimatedReliability = est.estimate;
+	return est;
+}
+
+UnreliabilityEstimate Graph::estUnreliabilityIS( long long t, int ceIterations, bool rawFormat, int threads )
+{
+	if ( threads <= 0 )
+		threads = nbrThreads;
 
-		// Is it a working all-terminal instance? (Are all nodes visited?)
-		int allterminal=1;
-		for ( int i=0; i<=biggestNodeId; ++i )
-			if ( nodeVisited[i]==false )
-				allterminal=0;
-		if (allterminal)
-			workingAllTerminalNetworks += 1;
+	std::vector<double> p;
+	getEdgeProbabilities( &p );
+
+	MTRand::uint32 seed = randomNbrGenerator.randInt();
+	UnreliabilityEstimate est = estimateUnreliabilityIS( *getTopology(), p, t, ceIterations, seed, threads );
+
+	if ( !rawFormat )
+	{
+		std::cout << "All-terminal unreliability = " << est.estimate << ", relative error "
+				  << est.relativeError << ", calculated from " << t << " importance samples\n";
 	}
 
-	if ( rawFormat )
+	latestEstimatedReliability = 1-est.estimate;
+	return est;
+}
+
+UnreliabilityEstimate Graph::estUnreliabilityTurnip( long long t, bool rawFormat, int threads )
+{
+	if ( threads <= 0 )
+		threads = nbrThreads;
+
+	std::vector<double> p;
+	getEdgeProbabilities( &p );
+
+	MTRand::uint32 seed = randomNbrGenerator.randInt();
+	UnreliabilityEstimate est = estimateUnreliabilityTurnip( *getTopology(), p, t, seed, threads );
+
+	if ( !rawFormat )
 	{
-		//std::cout << (float)(workingAllTerminalNetworks)/t << " ";
+		std::cout << "All-terminal unreliability = " << est.estimate << ", relative error "
+				  << est.relativeError << ", calculated from " << t << " turnip samples\n";
+	}
+
+	latestEstimatedReliability = 1-est.estimate;
+	return est;
+}
+
+double Graph::calcReliabilityExact( bool rawFormat )
+{
+	std::vector<double> p;
+	getEdgeProbabilities( &p );
 
+	double unreliability;
+	double reliability = exactReliability( *getTopology(), p, &unreliability );
+	if ( reliability < 0 )
+	{
+		if ( !rawFormat )
+			std::cout << "The network is too large for the exact reliability calculation\n";
+		return -1;
 	}
-	else
+
+	if ( !rawFormat )
 	{
-		std::cout << "All-terminal reliability = " << (float)(workingAllTerminalNetworks)/t  << ", calculated from "<< t <<" simulations\n";
+		std::cout << "All-terminal reliability = " << reliability << ", unreliability = "
+				  << unreliability << ", calculated exactly\n";
 	}
 
-	latestEstimatedReliability = (float)workingAllTerminalNetworks/t;
-	return latestEstimatedReliability;
+	latestEstimatedReliability = reliability;
+	return reliability;
 }
 
-bool Graph::unfoldGraph( int nc,  std::vector<Edge*> *connectingEdges, std::vector<bool>* visitedNodes )
+bool Graph::getReliabilityPolynomial( ReliabilityPolynomial *poly )
 {
-	//std::cout << "Iterating over edges connected to " << nc << std::endl;
-	visitedNodes->at(nc)=true;
+	const Topology *topo = getTopology();
 
-	std::vector<Edge*>::iterator it;
-	for ( it = connectingEdges[nc].begin(); it < connectingEdges[nc].end() ; ++it )
+	// The polynomial is in the probability of the edges taking part, so leave the disabled ones out
+	Topology working;
+	if ( std::find_if( edges.begin(), edges.end(), []( const Edge &e ) {return e.isDisabled();} ) != edges.end() )
 	{
-		//std::cout << "  Checking "<<(*it)->n[0]<<(*it)->n[1]<<" Status="<<(*it)->isWorking()<<std::endl;
-		if ( (*it)->isWorking() )
-		{
-			int newNode = (*it)->getConnectingNode(nc);
-
-			// Are these nodes visited earlier?
-			if ( visitedNodes->at(newNode) == false)
+		std::vector<int> ends, ids;
+		for ( size_t k=0; k<edges.size(); ++k )
+			if ( !edges[k].isDisabled() )
 			{
-				// Expand this new node
-				bool result = unfoldGraph( newNode, connectingEdges, visitedNodes );
+				ends.push_back( edges[k].getNodes()[0] );
+				ends.push_back( edges[k].getNodes()[1] );
+				ids.push_back( edges[k].getId() );
 			}
-		}
+		working.build( topo->getNbrNodes(), ends, ids );
+		topo = &working;
 	}
+	return poly->compute( *topo );
+}
 
-	// If we reach this far, then we've expanded the neighbors without finding the destination
-	return 0;
+void Graph::estReliabilityPolynomial( ReliabilityPolynomial *poly, long long t, int threads )
+{
+	if ( threads <= 0 )
+		threads = nbrThreads;
+
+	// Only which edges take part matters, not their reliability
+	std::vector<double> p( edges.size() );
+	for ( size_t k=0; k<edges.size(); ++k )
+		p[k] = edges[k].isDisabled() ? 0 : 1;
+
+	MTRand::uint32 seed = randomNbrGenerator.randInt();
+	estimatePolynomial( *getTopology(), p, t, seed, threads, poly );
+}
+
+const Topology* Graph::getTopology()
+{
+	if ( !topologyValid )
+		buildTopology();
+	return &topology;
+}
+
+void Graph::buildTopology()
+{
+	std::vector<int> ends, ids;
+	ends.reserve( 2*edges.size() );
+	ids.reserve( edges.size() );
+	std::vector<Edge>::iterator it;
+	for ( it = edges.begin(); it != edges.end() ; ++it )
+	{
+		ends.push_back( it->getNodes()[0] );
+		ends.push_back( it->getNodes()[1] );
+		ids.push_back( it->getId() );
+	}
+	topology.build( biggestNodeId+1, ends, ids );
+	topologyValid = true;
+}
+
+void Graph::getEdgeProbabilities( std::vector<double> *p )
+{
+	p->resize( edges.size() );
+	for ( size_t k=0; k<edges.size(); ++k )
+		(*p)[k] = edges[k].isDisabled() ? 0 : edges[k].getReliability();
 }
 
 
@@ -290,240 +402,629 @@ void doPercolationCalculation(Graph* network)
 
 	// In percolation mode, we want to calculate R(x,p) where N*x=F edges are removed
 	// immediately. p is the normal reliability per edge.
+	// Removing F random edges and letting the rest work with probability p leaves a random subset
+	// of the edges, uniform among those of its size. So the whole matrix follows from the share of
+	// connected subsets of each size, taken from the exact reliability polynomial or estimated by
+	// Newman-Ziff sweeps when the network is too large for it.
 	float stepSizeP = 0.05;
-	int iterations = 100; // Average over this many iterations
-	int MCiterations = 1e3;	// Do this many monte carlo iterations in the reliability estimation
+	long long sweeps = 1e5;	// Newman-Ziff sweeps when the network is too large for the exact polynomial
 
-	std::cout << "Averaging over "<<iterations<<" instances\n";
-	std::cout << "Doing "<<MCiterations<<" Monte Carlo steps per instance\n";
-	std::cout << "Percentage done: " << std::flush;
+	std::vector<float> ps;
+	for ( float p=0; p<1.0; p+=stepSizeP )
+		ps.push_back( p );
 
-	std::ofstream datafile( "data/percolation.plot", std::ios::out|std::ios::trunc );
+	ReliabilityPolynomial poly;
+	if ( network->getReliabilityPolynomial( &poly ) )
+		std::cout << "Using the exact reliability polynomial\n";
+	else
+	{
+		std::cout << "Estimating the reliability polynomial from "<<sweeps<<" Newman-Ziff sweeps\n";
+		network->estReliabilityPolynomial( &poly, sweeps );
+	}
 
-	// Disable f number of edges
-	for ( int f=0; f<network->getEdges()->size(); ++f )
+	// The rows are independent and only read poly, so they are spread over the threads
+	// and the matrix is written in order when all of them are done.
+	int rows = network->getEdges()->size();
+	std::vector<double> matrix( rows*ps.size() );
+	ThreadPool pool( Graph::getThreads() );
+	Progress progress( "Percentage done", rows );
+	pool.parallelFor( rows, [&]( long long f, int )
 	{
-		for ( float p=0; p<1.0; p+=stepSizeP )
-		{
-			float reliability = 0;
-			for ( int i=0;i<iterations; ++i )
-			{
-				// Disable N*x edges that will not take part of the simulation
-				network->disableXEdges(f);
-
-				network->setEdgeReliability( p );
-				float newRel = network->estReliabilityMC( MCiterations, 1 );
-				if ( newRel < 0 )
-					std::cout << "Something went wrong in the reliability estimation\n";
-				reliability += newRel;
-				// Restore the disabled edges
-				network->hardResetEdges();
-			}
+		// Disable f number of edges
+		for ( size_t j=0; j<ps.size(); ++j )
+			matrix[ f*ps.size()+j ] = poly.reliabilityAfterRemoving( f, ps[j] );
+		progress.advance();
+	});
+	progress.finish();
 
-			// Get the mean
-			reliability /= iterations;
-			datafile << reliability << " ";
-		}
+	std::ofstream datafile( "data/percolation.plot", std::ios::out|std::ios::trunc );
+	for ( int f=0; f<rows; ++f )
+	{
+		for ( size_t j=0; j<ps.size(); ++j )
+			datafile << matrix[ f*ps.size()+j ] << " ";
 		datafile << std::endl;
-
-		// Progressbar
-		std::cout << (int)((float)f/network->getEdges()->size()*100)<<" "<<std::flush;
-
 	}
-	std::cout << std::endl;
 	datafile.close();
 }
 
 
 
-int acoFindOptimal( Graph *nw, int Nmax, int nbrAnts, int maxLinksInSolution )
+/** Buffers for evaluating ants, one per thread. */
+struct AntScratch
 {
-	// Some parameters for the ACO algorithm
-	float Q = 1.0; 		// Determines the deltaTau
-	float rho = 0.80; 	// How fast old trails evaporate
-	int MCiterations = 1e4;	// How many iterations performed in Monte carlo
-								// TODO: Should probably depend on number of links
-	//float a = 1000;		// Exponent to C/C*
-	float b = 1000;		// Exponent to reliability/bestReliability
+	Topology topo;
+	std::vector<double> p;
+};
+
+/** Evaluate a solution in the ACO on the network of its chosen links.
+	It is calculated exactly as long as the networks are small enough, after the first one that
+	is not exact is cleared and t Monte Carlo samples seeded from rng are used instead, on threads threads. */
+static SolutionEvaluation acoEvaluate( const Topology &base, const std::vector<double> &pBase, const Ant &ant,
+									   AntScratch &scratch, int t, bool &exact, MTRand &rng, int threads=0 )
+{
+	ant.getTopology( base, pBase, &scratch.topo, &scratch.p );
 
+	SolutionEvaluation evaluation;
+	if ( exact )
+	{
+		double reliability = exactReliability( scratch.topo, scratch.p );
+		if ( reliability >= 0 )
+		{
+			evaluation.reliability = reliability;
+			evaluation.exact = true;
+			return evaluation;
+		}
+		exact = false;
+	}
 
+	if ( threads <= 0 )
+		threads = Graph::getThreads();
+	evaluation.samples = t;
+	evaluation.working = countConnected( scratch.topo, scratch.p, t, rng.randInt(), threads, MC_BITPARALLEL );
+	evaluation.reliability = (double)evaluation.working/t;
+	return evaluation;
+}
 
-	std::cout << "Starting ACO with parameters: ";
-	std::cout << "Nmax="<<Nmax<<" nbrAnts="<<nbrAnts<< " maxLinks="<<maxLinksInSolution <<" b="<<b<<std::endl;
+/** Evaluate a solution like acoEvaluate, store the reliability in the ant and print it unless rawFormat. */
+static float acoReliability( const Topology &base, const std::vector<double> &pBase, Ant &ant,
+							 AntScratch &scratch, int t, bool rawFormat, bool &exact, MTRand &rng, int threads=0 )
+{
+	SolutionEvaluation evaluation = acoEvaluate( base, pBase, ant, scratch, t, exact, rng, threads );
+	if ( !rawFormat )
+	{
+		if ( evaluation.exact )
+			std::cout << "All-terminal reliability = " << evaluation.reliability << ", calculated exactly\n";
+		else
+			std::cout << "All-terminal reliability = " << evaluation.reliability << ", calculated from "<< t <<" simulations\n";
+	}
 
-	Ant *bestAnt=0;
+	ant.setLatestReliability( evaluation.reliability );
+	return evaluation.reliability;
+}
 
-	// Initialize the pheromones to tau_0, by resetting the edges
-	// Reset all edges to working state
-	std::vector<Edge*>::iterator it;
-	for ( it = nw->getEdges()->begin(); it != nw->getEdges()->end() ; ++it )
-		(*it)->hardReset();
+/** Evaluate the ants marked in evaluate with Monte Carlo by racing them. All ants get samples in
+	rounds and an ant stops as soon as the upper end of its confidence interval is below the lower
+	end of the best one, the others share the budget of MCiterations samples per ant. The samples
+	of ant a are drawn from rngs[a] and returned in fresh[a], known[a] holds the samples from before
+	(or the value of the ants not evaluated). Returns the number of samples used. */
+static long long acoRace( const Topology &base, const std::vector<double> &pBase, const std::vector<Ant> &ants,
+						  const std::vector<char> &evaluate, const std::vector<SolutionEvaluation> &known,
+						  std::vector<SolutionEvaluation> &fresh, std::vector<MTRand> &rngs,
+						  int MCiterations, ThreadPool &pool )
+{
+	const double confidence = 0.99;
+	int roundSamples = std::max( MCiterations/8, 1 );
+
+	int n = ants.size();
+	std::vector<AntScratch> networks( n );
+	std::vector<int> racing;
+	for ( int a=0; a<n; ++a )
+		if ( evaluate[a] )
+		{
+			ants[a].getTopology( base, pBase, &networks[a].topo, &networks[a].p );
+			fresh[a] = SolutionEvaluation();
+			racing.push_back( a );
+		}
+
+	// The estimate and interval of ant a from everything known about it
+	auto interval = [&]( int a ) {
+		if ( !evaluate[a] && known[a].exact )
+		{
+			ReliabilityEstimate e;
+			e.estimate = e.lower = e.upper = known[a].reliability;
+			return e;
+		}
+		return wilsonInterval( known[a].working + fresh[a].working, known[a].samples + fresh[a].samples, confidence );
+	};
 
-	int allNodes = nw->getBiggestNodeId();
+	long long budget = (long long)racing.size()*MCiterations;
+	long long used = 0;
+	while ( budget > 0 && !racing.empty() )
+	{
+		// A single ant left only needs the samples it would have got without racing
+		if ( racing.size() == 1 && fresh[racing[0]].samples >= MCiterations )
+			break;
 
+		pool.parallelFor( racing.size(), [&]( long long i, int )
+		{
+			int a = racing[i];
+			fresh[a].working += countConnected( networks[a].topo, networks[a].p, roundSamples,
+												rngs[a].randInt(), 1, MC_BITPARALLEL );
+			fresh[a].samples += roundSamples;
+		});
+		used += racing.size()*roundSamples;
+		budget -= racing.size()*roundSamples;
+
+		double bestLower = 0;
+		for ( int a=0; a<n; ++a )
+			bestLower = std::max( bestLower, interval(a).lower );
+
+		std::vector<int> stillRacing;
+		for ( size_t i=0; i<racing.size(); ++i )
+			if ( interval( racing[i] ).upper >= bestLower )
+				stillRacing.push_back( racing[i] );
+		racing.swap( stillRacing );
+	}
 
+	for ( int a=0; a<n; ++a )
+		if ( evaluate[a] && fresh[a].samples > 0 )
+			fresh[a].reliability = (double)fresh[a].working/fresh[a].samples;
+	return used;
+}
 
-	std::list<Ant*> ants;
+/** One colony of the ACO search: its ants, pheromone trails and everything that follows a
+	single line of search. Colonies only share the network they search. */
+class AcoColony
+{
+public:
+	/** A colony searching network with the pheromones of store. Its random numbers come from rng,
+		which must outlive the colony, and the final evaluation of its best ant runs on
+		evaluationThreads threads. The ants are built and evaluated on a pool of poolThreads threads. */
+	AcoColony( Graph *network, int nbrAnts, int maxLinksInSolution, const AcoParameters &parameters,
+			   MTRand *rng, int evaluationThreads, size_t cacheBytes, int poolThreads );
+
+	// An iteration is done in steps, so that the ants of all colonies can share the same parallel
+	// loops: beginIteration, buildAnt for every ant, lookUp, tryExact, evaluateAnt for every ant
+	// and endIteration. worker is the thread of the pool an ant is handled on.
+
+	/** Draw the seed of the iteration and the probabilities the links are chosen with. */
+	void beginIteration();
+	/** Build a new solution for ant a, unless it is the best ant of the iteration before. */
+	void buildAnt( int a, int worker );
+	/** Look the ants up in the cache. When racing, the others are raced on pool right away. */
+	void lookUp( ThreadPool &pool );
+	/** Try the exact calculation on the first ant to evaluate. Once the solutions have grown too
+		large for it, the other ants go straight to Monte Carlo instead of each running into the
+		state limit. */
+	void tryExact();
+	/** Evaluate ant a, unless lookUp or tryExact already did. */
+	void evaluateAnt( int a, int worker );
+	/** Pick the best ant of iteration N of Nmax and update the pheromones. */
+	void endIteration( int N, int Nmax );
+
+	/** Offer the colony an ant from another colony. It replaces the best ant of the colony if it
+		is better, which makes it lay pheromones here too and keeps it for the next iteration. */
+	void immigrate( const Ant &immigrant );
+
+	/** The best solution of the search so far. */
+	Ant& getBest() {return parameters.mmas ? globalBest : ants[0];};
+	bool hasBest() const {return bestAnt >= 0;};
+	/** The pheromones of the colony, per edge id */
+	EdgeStore& getTrails() {return trails;};
+	bool isExact() const {return exact;};
+	/** Monte Carlo samples used so far */
+	long long getSamples() const {return samples;};
+
+	EvaluationCache cache;
+	int iterationBest;			//!< Index the best ant of the latest iteration had before it moved to slot 0
+	float bestReliability;		//!< Of the best ant of the latest iteration
+	float bestCost;
+	bool restarted;				//!< The pheromones were reset in the latest iteration
+	long long racedSamples;
+	long long unracedSamples;
+
+private:
+	Graph *network;
+	const Topology &base;		//!< All ants are solutions on the same network
+	std::vector<double> pBase;
+	std::vector<int> ids;		//!< Edge id of each link
+	int maxLinks;
+	int maxLinksInSolution;
+	const AcoParameters &parameters;
+	bool useCache;
+	long long maxPooledSamples;
+	long long samples;
+
+	EdgeStore trails;
+	bool exact;					//!< Calculate the reliabilities exactly while the solutions are small enough
+	MTRand *rng;
+	int evaluationThreads;
+
+	// The ants are allocated once and reused. The best ant of an iteration is kept in slot 0
+	// and the other slots get new solutions.
+	std::vector<Ant> ants;
+	int bestAnt;
+
+	// The best solution so far and how long ago it improved, for the MAX-MIN Ant System
+	Ant globalBest;
+	float globalBestReliability;
+	int sinceImprovement;
+
+	std::vector<AntScratch> scratch;
+	std::vector<MTRand> rngs;
+	std::vector<double> linkWeights;
+	FenwickTree allLinks;
+	std::vector<FenwickTree> wheels;
+
+	// The iteration being done
+	MTRand::uint32 iterationSeed;
+	std::vector<SolutionEvaluation> known;	//!< From the cache
+	std::vector<SolutionEvaluation> fresh;	//!< Done in this iteration
+	std::vector<char> evaluate;				//!< The ant needs a new evaluation
+	std::vector<char> antExact;				//!< The ant may still be calculated exactly
+	bool race;
+	size_t tried;							//!< The ant tryExact evaluated, or the number of ants
+};
+
+AcoColony::AcoColony( Graph *_network, int nbrAnts, int _maxLinksInSolution, const AcoParameters &_parameters,
+					  MTRand *_rng, int _evaluationThreads, size_t cacheBytes, int poolThreads )
+	: cache( cacheBytes ), iterationBest( -1 ), bestReliability( 0 ), bestCost( 0 ), restarted( false ), racedSamples( 0 ), unracedSamples( 0 ),
+	  network( _network ), base( *_network->getTopology() ), maxLinks( _network->getEdges()->size() ),
+	  maxLinksInSolution( _maxLinksInSolution ), parameters( _parameters ), samples( 0 ),
+	  trails( *_network->getEdgeStore() ), exact( true ), rng( _rng ), evaluationThreads( _evaluationThreads ),
+	  ants( nbrAnts, Ant(maxLinks) ), bestAnt( -1 ), globalBest( maxLinks ), globalBestReliability( -1 ),
+	  sinceImprovement( 0 ), scratch( poolThreads ), rngs( nbrAnts, MTRand( (MTRand::uint32)0 ) ),
+	  linkWeights( maxLinks ), wheels( poolThreads ), iterationSeed( 0 ), known( nbrAnts ), fresh( nbrAnts ),
+	  evaluate( nbrAnts ), antExact( nbrAnts ), race( false ), tried( nbrAnts )
+{
+	// Solutions found again are taken from the cache. Sampled ones get more samples until they
+	// have as many as the best ant gets in the end.
+	useCache = cacheBytes > 0;
+	maxPooledSamples = 10*(long long)parameters.MCiterations;
+
+	network->getEdgeProbabilities( &pBase );
+	for ( int i=0; i<maxLinks; ++i )
+		ids.push_back( (*network->getEdges())[i].getId() );
+}
 
+void AcoColony::beginIteration()
+{
+	restarted = false;
 
-	for ( int N=0; N<Nmax; ++N )
+	// Generate K=nbrAnts solutions
+
+	// The ants are built and evaluated in parallel. Every ant gets its own random stream,
+	// seeded from the colony's generator and the index of the ant, so the run only depends
+	// on the seed and not on the number of threads.
+	iterationSeed = rng->randInt();
+
+	// p is the probability that an edge is chosen (level=1)
+	// This assumes only on/off state of the link
+	for ( int i=0; i<maxLinks; ++i )
 	{
+		float tau0 = trails.getTau(0)[ ids[i] ], tau1 = trails.getTau(1)[ ids[i] ];
+		linkWeights[i] = tau1 / (tau0 + tau1);
+	}
+	allLinks.build( linkWeights );
+}
 
-		// Generate K=nbrAnts solutions
+void AcoColony::buildAnt( int a, int worker )
+{
+	Ant &ant = ants[a];
+	MTRand::uint32 key[2] = { iterationSeed, (MTRand::uint32)a };
+	MTRand &antRng = rngs[a];
+	antRng.seed( key, 2 );
+
+	// If this is the best solution from the last iteration
+	// the path is already known
+	if ( a != bestAnt )
+	{
+		ant.reset( maxLinks );
 
+		// Picking a link at random and keeping it with probability p = tau1/sumTau until
+		// enough links are chosen gives every next link with probability proportional to p.
+		// The wheel draws from that directly and drops the chosen links, so it terminates
+		// even when the pheromones of the remaining links are close to 0.
+		FenwickTree &wheel = wheels[worker];
+		wheel = allLinks;
 
-		for (int i=ants.size(); i < nbrAnts; ++i)
+		int nbrAddedLinks=0;
+		while ( nbrAddedLinks < maxLinksInSolution && nbrAddedLinks < maxLinks )
 		{
-			// Initialize the list by allocating new objects
-			int size = nw->getEdges()->size();
-			Ant *ant = new Ant(size);
-			ants.push_back(ant);
-			//std::cout << "Creating \t"<<ant<<std::endl;
+			int i = wheel.find( antRng()*wheel.getTotal() );
+
+			// No pheromones left on the remaining links, pick one of them uniformly
+			while ( i < 0 || ant.getLinkLevel(i) )
+				i = antRng.randInt( maxLinks-1 );
+
+			ant.setLinkLevel( i, 1); // Path was chosen
+			wheel.remove( i );
+			++nbrAddedLinks;
 		}
+	}
+}
 
+void AcoColony::lookUp( ThreadPool &pool )
+{
+	// Look the solutions up in the order of the ants and add the new evaluations in the same
+	// order in endIteration, so the cache does not depend on which thread finished first either
+	std::fill( known.begin(), known.end(), SolutionEvaluation() );
+	std::fill( fresh.begin(), fresh.end(), SolutionEvaluation() );
+	std::fill( evaluate.begin(), evaluate.end(), 1 );
+	for ( size_t a=0; a<ants.size() && useCache; ++a )
+	{
+		bool isKnown = cache.find( ants[a].getLinks(), &known[a] );
+		if ( isKnown && (known[a].exact || known[a].samples >= maxPooledSamples) )
+			evaluate[a] = 0;
+	}
 
-		// Find the ant's paths
+	race = parameters.racing && !exact;
+	if ( race )
+	{
+		long long used = acoRace( base, pBase, ants, evaluate, known, fresh, rngs, parameters.MCiterations, pool );
+		racedSamples += used;
+		samples += used;
+	}
+}
 
-		std::list<Ant*>::iterator antIt;
-		for ( antIt=ants.begin(); antIt != ants.end(); ++antIt )
-		{
+void AcoColony::tryExact()
+{
+	std::fill( antExact.begin(), antExact.end(), exact );
+	tried = std::find( evaluate.begin(), evaluate.end(), 1 ) - evaluate.begin();
+	if ( race || !exact )
+		tried = ants.size();
+	if ( tried < ants.size() )
+	{
+		bool antIsExact = true;
+		fresh[tried] = acoEvaluate( base, pBase, ants[tried], scratch[0], parameters.MCiterations, antIsExact, rngs[tried], 1 );
+		std::fill( antExact.begin(), antExact.end(), antIsExact );
+	}
+}
 
+void AcoColony::evaluateAnt( int a, int worker )
+{
+	// Evaluate the ant, the pool already keeps all threads busy
+	if ( race || !evaluate[a] || a == (int)tried )
+		return;
+	bool antIsExact = antExact[a];
+	fresh[a] = acoEvaluate( base, pBase, ants[a], scratch[worker], parameters.MCiterations, antIsExact, rngs[a], 1 );
+	antExact[a] = antIsExact;
+}
 
-			// If this is the best solution from the last iteration
-			// the path is already known
-			if (*antIt == bestAnt)
-				continue;
+void AcoColony::endIteration( int N, int Nmax )
+{
+	float Q = parameters.Q;
+	float b = parameters.b;
+	int MCiterations = parameters.MCiterations;
 
+	// The exact calculation is given up for the coming iterations if it failed for any ant
+	for ( size_t a=0; a<ants.size() && !race; ++a )
+	{
+		exact = exact && antExact[a];
+		samples += fresh[a].samples;
+	}
+	for ( size_t a=0; a<ants.size() && race; ++a )
+		if ( evaluate[a] )
+			unracedSamples += MCiterations;
 
+	for ( size_t a=0; a<ants.size(); ++a )
+	{
+		SolutionEvaluation evaluation = fresh[a];
+		if ( !evaluate[a] )
+			evaluation = known[a];
+		else if ( useCache )
+			evaluation = cache.add( ants[a].getLinks(), fresh[a] );
+		ants[a].setLatestReliability( evaluation.reliability );
+	}
 
-			// Pick one edge at random, roll the dice, compare to the pheromones
-			// and add the edge to the ant's path if dice is high enough
-			// do this as many times as needed to get maxCost edges
-			std::vector<Edge*> &edges = *(nw->getEdges());
-			int maxEdges = edges.size();
+	// Begin the global updating
+	bestCost = 0;
+	bestReliability = 0;
 
-			// Keep adding links to this ant until enough have been chosen.
-			// Pick one link at random, roll the dice and compare with pheromones
-			int nbrAddedLinks=0;
-			std::vector<int> addedLinks(edges.size());
-			for (int i=0;i<edges.size();++i)
-				addedLinks[i]=0;
+	// Pick the best ant
+	for ( int a=0; a<(int)ants.size(); ++a )
+	{
+		float cost = ants[a].getCost() ;
+		float reliability = ants[a].getLatestReliability();
 
-			while ( nbrAddedLinks < maxLinksInSolution )
-			{
+		if ( reliability > bestReliability || bestAnt < 0 )
+		{
+			bestCost = cost;
+			bestReliability = reliability;
 
-				int i =  maxEdges* randomNbrGenerator();
-				// Pick a random link
-
-				// Is this link already chosen?
-				if ( addedLinks[i] )
-					continue;
-
-				// Calculate the probability to choose this link
-				float sumTaus = edges[i]->getSumTau();
-				float p=		edges[i]->getTau(1) / sumTaus;
-
-				// p is now the probability that this edge is chosen (level=1)
-				// This assumes only on/off state of the link
-				if ( p > randomNbrGenerator() )
-				{
-					(*antIt)->addEdge( edges[i] );
-					(*antIt)->setLinkLevel( i, 1); // Path was chosen
-					++nbrAddedLinks;
-					addedLinks[i]=1;
-				}
-			}
+			bestAnt = a;
 		}
+	}
 
-		// Begin the global updating
-		float bestCost = 0;
-		float bestReliability = 0;
 
-		// Evaluate each ant
-		for ( antIt=ants.begin(); antIt != ants.end(); ++antIt )
-		{
+	if ( N+1 == Nmax )
+	{
+		bestReliability = acoReliability( base, pBase, ants[bestAnt], scratch[0], 10*MCiterations,
+										  true, exact, *rng, evaluationThreads );
+		if ( !exact )
+			samples += 10*(long long)MCiterations;
+	}
 
-			//std::cout << "size of antIt edges: " <<(*antIt).getEdges()->size();
-			float cost = (*antIt)->getCost() ;
-			float reliability = (*antIt)->estReliabilityMC( MCiterations, true );
 
+	// The remaining ants are all valid solutions
 
-			if ( reliability > bestReliability )
-			{
-				bestCost = cost;
-				bestReliability = reliability;
+	// Perform the global updating rule
 
-				bestAnt = (*antIt);
-			}
+
+	// Iterate over ALL edges and apply pheromones accordingly
+	// This means, iterate over ant. which says if link i is working or not
+	// The deltaTau is collected directly in the trails of the colony.
+	if ( parameters.mmas )
+	{
+		if ( bestReliability > globalBestReliability )
+		{
+			globalBest = ants[bestAnt];
+			globalBestReliability = bestReliability;
+			sinceImprovement = 0;
 		}
+		else
+			++sinceImprovement;
 
+		// Only one ant lays pheromones, mostly the best of this iteration
+		const Ant &depositor = (N+1) % parameters.mmasGlobalBestInterval == 0 ? globalBest : ants[bestAnt];
+		for ( int i=0; i<maxLinks; ++i )
+			trails.getDeltaTau( depositor.getLinkLevel(i) )[ ids[i] ] += Q*depositor.getLatestReliability();
+	}
+	else
+	{
+		// Loop over each link in each ant and update tau
+		for ( size_t a=0; a<ants.size(); ++a )
+		{
+			float reliability = ants[a].getLatestReliability();
+			float D = pow(reliability/bestReliability, b);
 
-		if ( N+1 == Nmax )
-			bestReliability = bestAnt->estReliabilityMC(10*MCiterations, true);
-		std::cout << "Best ant: "<<bestAnt<< " reliability: "<<bestReliability<< " cost: "<<bestCost<<std::endl;
+			for ( int i=0; i<maxLinks; ++i )
+			{
+				int level =  ants[a].getLinkLevel(i);
 
+				trails.getDeltaTau(level)[ ids[i] ] += Q*D;
 
-		// The remaining ants are all valid solutions
+			}
+		}
+	}
 
-		// Perform the global updating rule
+	// Keep the best solution unchanged in slot 0, the others are replaced in the next iteration
+	iterationBest = bestAnt;
+	std::swap( ants[0], ants[bestAnt] );
+	bestAnt = 0;
 
 
-		// Iterate over ALL edges and apply pheromones accordingly
-		// This means, iterate over ant. which says if link i is working or not
-		std::vector<Edge*> *allEdges = nw->getEdges();
-		int maxLinks = allEdges->size();
-		std::vector<std::vector<float>> deltaTau(maxLinks,std::vector<float>(Edge::maxLevels));
-		for (int i=0;i<maxLinks; ++i)
-			for ( int level=0; level<Edge::maxLevels; ++level )
-				deltaTau[i][level] = 0;
+	// The next step is to update the colony's pheromone levels with this new deltaTau
+	trails.updateTau( parameters.rho );
 
-		// Loop over each link in each ant and update tau
-		for (antIt = ants.begin(); antIt != ants.end();)
+	// The largest tau an edge can reach is the deposit of the best ant accumulated forever
+	if ( parameters.mmas && globalBestReliability > 0 )
+	{
+		float tauMax = Q*globalBestReliability/(1-parameters.rho);
+		if ( sinceImprovement >= parameters.mmasRestartAfter )
 		{
+			trails.fillTau( tauMax );
+			sinceImprovement = 0;
+			restarted = true;
+		}
+		else
+			trails.clampTau( parameters.mmasMinRatio*tauMax, tauMax );
+	}
+}
 
-			//std::cout << "Accessing \t"<<*antIt<<std::endl;
+void AcoColony::immigrate( const Ant &immigrant )
+{
+	if ( bestAnt < 0 || immigrant.getLatestReliability() <= getBest().getLatestReliability() )
+		return;
 
-			float reliability = (*antIt)->getLatestReliability();
-			float D = pow(reliability/bestReliability, b);
+	ants[0] = immigrant;
+	if ( parameters.mmas )
+	{
+		globalBest = immigrant;
+		globalBestReliability = immigrant.getLatestReliability();
+		sinceImprovement = 0;
+	}
+}
 
-			for ( int i=0; i<maxLinks; ++i )
-			{
-				int level =  (*antIt)->getLinkLevel(i);
+int acoFindOptimal( Graph *nw, int Nmax, int nbrAnts, int maxLinksInSolution, const AcoParameters &parameters,
+					AcoResult *result )
+{
+	// Initialize the pheromones to tau_0, by resetting the edges
+	// Reset all edges to working state
+	std::vector<Edge>::iterator it;
+	for ( it = nw->getEdges()->begin(); it != nw->getEdges()->end() ; ++it )
+		it->hardReset();
 
-				float reliability = (*antIt)->getLatestReliability();
-				float D = pow(reliability/bestReliability, b);
+	ThreadPool pool( Graph::getThreads() );
+	return acoSearch( nw, Nmax, nbrAnts, maxLinksInSolution, parameters, randomNbrGenerator, pool, result );
+}
 
-				deltaTau[i][level] += Q*D;
+int acoSearch( Graph *nw, int Nmax, int nbrAnts, int maxLinksInSolution, const AcoParameters &parameters,
+			   MTRand &rng, ThreadPool &pool, AcoResult *result, bool quiet )
+{
+	int nbrColonies = std::max( parameters.colonies, 1 );
+	int MCiterations = parameters.MCiterations;	// How many iterations performed in Monte carlo
+								// TODO: Should probably depend on number of links
+	float b = parameters.b;		// Exponent to reliability/bestReliability
 
-			}
+	// Single evaluations get all threads, unless the search itself runs inside a parallel loop
+	int evaluationThreads = ThreadPool::insideParallelFor() ? 1 : Graph::getThreads();
 
 
-			// Reset all the solutions except for the best one
-			// Keep the best one unchanged.
-			if (*antIt != bestAnt )
-			{
-				//std::cout << "deleting \t"<< *antIt<<std::endl;
-				delete *antIt;
-				antIt = ants.erase(antIt);
-			}
-			else
-			{
-				++antIt;
-			}
+	if ( !quiet )
+	{
+		std::cout << "Starting ACO with parameters: ";
+		std::cout << "Nmax="<<Nmax<<" nbrAnts="<<nbrAnts<< " maxLinks="<<maxLinksInSolution <<" b="<<b;
+		if ( nbrColonies > 1 )
+			std::cout << " colonies="<<nbrColonies;
+		std::cout << std::endl;
+	}
 
+	// A single colony runs on rng. Several colonies each get a generator seeded from it and
+	// run side by side with their own pheromones and cache, the ants of all colonies are built
+	// and evaluated in the same parallel loops.
+	std::vector<MTRand> colonyRngs;
+	for ( int c=0; c<nbrColonies && nbrColonies > 1; ++c )
+		colonyRngs.push_back( MTRand( rng.randInt() ) );
+
+	std::vector< std::unique_ptr<AcoColony> > colonies;
+	for ( int c=0; c<nbrColonies; ++c )
+		colonies.emplace_back( new AcoColony( nw, nbrAnts, maxLinksInSolution, parameters,
+											  nbrColonies > 1 ? &colonyRngs[c] : &rng,
+											  evaluationThreads,
+											  ((size_t)parameters.cacheMegabytes << 20)/nbrColonies,
+											  pool.getThreads() ) );
+
+	long long nbrAllAnts = (long long)nbrColonies*nbrAnts;
+	for ( int N=0; N<Nmax; ++N )
+	{
+		for ( int c=0; c<nbrColonies; ++c )
+			colonies[c]->beginIteration();
+		pool.parallelFor( nbrAllAnts, [&]( long long i, int worker )
+		{
+			colonies[i/nbrAnts]->buildAnt( i%nbrAnts, worker );
+		});
+		for ( int c=0; c<nbrColonies; ++c )
+			colonies[c]->lookUp( pool );
+		pool.parallelFor( nbrColonies, [&]( long long c, int )
+		{
+			colonies[c]->tryExact();
+		});
+		pool.parallelFor( nbrAllAnts, [&]( long long i, int worker )
+		{
+			colonies[i/nbrAnts]->evaluateAnt( i%nbrAnts, worker );
+		});
+		for ( int c=0; c<nbrColonies; ++c )
+			colonies[c]->endIteration( N, Nmax );
 
+		for ( int c=0; c<nbrColonies && !quiet; ++c )
+		{
+			if ( nbrColonies > 1 )
+				std::cout << "Colony " << c << " best";
+			else
+				std::cout << "Best";
+			std::cout << " ant: "<<colonies[c]->iterationBest<< " reliability: "<<colonies[c]->bestReliability<< " cost: "<<colonies[c]->bestCost<<std::endl;
+			if ( colonies[c]->restarted )
+				std::cout << "No improvement for " << parameters.mmasRestartAfter << " iterations, resetting the pheromones\n";
 		}
 
-
-		// The next step is to update the network's pheromone levels with this new deltaTau
-		for (int i=0;i<maxLinks; ++i)
+		// Every colony gets the best solution of the colony before it in the ring, or the best
+		// of all the others. The solutions are copied before any colony changes.
+		if ( nbrColonies > 1 && parameters.migrationInterval > 0 &&
+			 (N+1) % parameters.migrationInterval == 0 && N+1 < Nmax )
 		{
-			for ( int level=0; level<Edge::maxLevels; ++level )
+			std::vector<Ant> emigrants;
+			for ( int c=0; c<nbrColonies; ++c )
+				emigrants.push_back( colonies[c]->getBest() );
+			for ( int c=0; c<nbrColonies; ++c )
 			{
-				// The next step is to update the network's pheromone levels with this new deltaTau
-				float oldTau = (*allEdges)[i]->getTau( level );
-				float newTau = deltaTau[i][level] + rho * oldTau;
-				(*allEdges)[i]->setTau(level, newTau);
+				int from = (c+nbrColonies-1) % nbrColonies;
+				if ( parameters.migration == MIGRATION_FULL )
+					for ( int o=0; o<nbrColonies; ++o )
+						if ( o != c && (from == c ||
+							 emigrants[o].getLatestReliability() > emigrants[from].getLatestReliability()) )
+							from = o;
+				colonies[c]->immigrate( emigrants[from] );
 			}
 		}
 
@@ -535,207 +1036,351 @@ int acoFindOptimal( Graph *nw, int Nmax, int nbrAnts, int maxLinksInSolution )
 		//std::cout << "Starting new iteration\n";
 	}
 
-	std::cout << "Links chosen by the best ant:\n";
-	bestAnt->printEdges();
-	std::cout << "All links:\n";
-	nw->printEdges();
+	if ( !colonies[0]->hasBest() )
+		return NO_ERROR;
+
+	// The best solution of all colonies, the MAX-MIN search may have left it behind after a restart
+	int bestColony = 0;
+	for ( int c=1; c<nbrColonies; ++c )
+		if ( colonies[c]->getBest().getLatestReliability() > colonies[bestColony]->getBest().getLatestReliability() )
+			bestColony = c;
+	AcoColony &colony = *colonies[bestColony];
+	Ant &best = colony.getBest();
+
+	if ( !quiet )
+	{
+		nw->getEdgeStore()->copyTau( colony.getTrails() );
+
+		if ( nbrColonies > 1 )
+			std::cout << "Best solution found by colony " << bestColony << std::endl;
+		std::cout << "Links chosen by the best ant:\n";
+		best.printEdges( nw );
+		std::cout << "All links:\n";
+		nw->printEdges();
+	}
+
+	const Topology &base = *nw->getTopology();
+	std::vector<double> pBase;
+	nw->getEdgeProbabilities( &pBase );
+	AntScratch scratch;
+	bool exact = colony.isExact();
+	float reliability = acoReliability( base, pBase, best, scratch, 100*MCiterations, quiet, exact, rng,
+										evaluationThreads );
 
-	bestAnt->estReliabilityMC(100*MCiterations,false);
+	long long samples = 0, racedSamples = 0, unracedSamples = 0, hits = 0, misses = 0;
+	for ( int c=0; c<nbrColonies; ++c )
+	{
+		samples += colonies[c]->getSamples();
+		racedSamples += colonies[c]->racedSamples;
+		unracedSamples += colonies[c]->unracedSamples;
+		hits += colonies[c]->cache.getHits();
+		misses += colonies[c]->cache.getMisses();
+	}
+	if ( !exact )
+		samples += 100*(long long)MCiterations;
 
+	if ( unracedSamples > 0 && !quiet )
+		std::cout << "Racing used " << racedSamples << " of " << unracedSamples << " Monte Carlo samples\n";
+	if ( parameters.cacheMegabytes > 0 && !quiet )
+		std::cout << "Evaluation cache: " << hits << " hits, " << misses << " misses\n";
 
-	delete bestAnt;
+	if ( result )
+	{
+		result->reliability = reliability;
+		result->exact = exact;
+		result->cost = best.getCost();
+		result->links.clear();
+		for ( int i=0; i<(int)nw->getEdges()->size(); ++i )
+			if ( best.getLinkLevel(i) )
+				result->links.push_back( (*nw->getEdges())[i].getId() );
+		result->colony = bestColony;
+		result->samples = samples;
+		result->colonyReliability.clear();
+		for ( int c=0; c<nbrColonies; ++c )
+			result->colonyReliability.push_back( colonies[c]->getBest().getLatestReliability() );
+	}
 
 	return NO_ERROR;
 }
 
 enum filetype { TYPE_EDGES };
 
-int Graph::loadEdgeDataFromGraphML(std::string filename, double graphprobabiledge)
+int Graph::loadEdgeDataFromGraphML(std::string filename, double graphprobabiledge, bool streaming)
 {
 	cleanup();
+	finalCleanup();
 	latestEstimatedReliability = -1;
 
-	pugi::xml_document doc;
-	pugi::xml_parse_result result = doc.load_file(filename.c_str());
-	pugi::xml_node graph = doc.child("graphml").child("graph");
-	if (result)
-	{
-		std::vector<std::string> nodes = std::vector<std::string>();
-		auto c = graph.first_child();
-		for (pugi::xml_node elem : graph)
+	GraphMLFile file;
+	if ( file.read( filename.c_str(), streaming, graphprobabiledge ) != NO_ERROR )
+		return FILE_OPEN_ERROR;
+
+	// The nodes are numbered in the order they are declared, their ids are looked up in a hash map
+	const std::vector<std::string_view> &nodes = file.getNodes();
+	std::unordered_map<std::string_view, int> index;
+	index.reserve( nodes.size() );
+	for ( size_t i=0; i<nodes.size(); ++i )
+		if ( !index.emplace( nodes[i], i ).second )
 		{
-			std::string str = elem.name();
-			if (str == "node")
-			{
-				nodes.push_back(elem.attribute("id").as_string());
-				if (nodes.size() > biggestNodeId) biggestNodeId = nodes.size() - 1;
-			}
-			if (str == "edge")
-			{
-				
-
-				std::vector<std::string>::iterator sourcit = std::find(nodes.begin(), nodes.end(), elem.attribute("source").as_string());
-				std::vector<std::string>::iterator targetit = std::find(nodes.begin(), nodes.end(), elem.attribute("target").as_string());
-				
-				int n1 = std::distance(nodes.begin(), sourcit)-1;
-				//std::cout << " source it " << n1;
-
-				int n2 = std::distance(nodes.begin(), targetit)-1;
-				//std::cout << "target it " << n2<< "\n";
-				Edge* e = new Edge(n1, n2, graphprobabiledge);
-				edges.push_back(e);
-				if (elem.attribute("directed"))
-				{
-					Edge* e = new Edge(n2, n1, graphprobabiledge);
-					edges.push_back(e);
-				}
-			}
+			std::cout << filename << ": node " << nodes[i] << " is declared twice\n";
+			return ILLEGAL_NODE_ID;
 		}
+	if ( (int)nodes.size()-1 > biggestNodeId )
+		biggestNodeId = nodes.size()-1;
 
-		// Given a node, we want to quickly find what edges are connecting to this node
-		// Thus we keep an array of vectors, where each element in the array corresponds
-		// to a node and holds a linked vector with all the connecting edges
-		connectingEdges = new std::vector<Edge*>[biggestNodeId + 1];
-
-		// Now, go through edges and put each edge in the right element in connectingEdges
-		std::vector<Edge*>::iterator it;
-		for (it = edges.begin(); it < edges.end(); ++it)
+	const std::vector<GraphMLEdge> &fileEdges = file.getEdges();
+	edges.reserve( fileEdges.size() );
+	store.reserve( fileEdges.size() );
+	for ( size_t i=0; i<fileEdges.size(); ++i )
+	{
+		const GraphMLEdge &e = fileEdges[i];
+		auto source = index.find( e.source ), target = index.find( e.target );
+		if ( source == index.end() || target == index.end() )
 		{
-			std::cout << (*it)->getNodes()[0] << " " << (*it)->getNodes()[1] << " " << biggestNodeId <<  std::endl;
-			const int* n = (*it)->getNodes();
-			connectingEdges[n[0]].push_back(*it); // Add a copy of *it to connectingEdges
-			connectingEdges[n[1]].push_back(*it);
+			std::cout << filename << ": edge " << e.source << "-" << e.target << " refers to a node that is not declared\n";
+			finalCleanup();
+			return ILLEGAL_NODE_ID;
 		}
 
-		//for (int i=0; i<=biggestNodeId; ++i)
-		//{
-		//	std::cout << "node "<<i<<" has the following edges\n";
-		//	for (it = connectingEdges[i].begin(); it < connectingEdges[i].end() ; ++it )
-		//	{
-		//		std::cout << (*it)->getNodes()[0] << " " << (*it)->getNodes()[1] << std::endl;
-		//	}
-		//}
-		return NO_ERROR;
+		int n1 = source->second, n2 = target->second;
+		edges.push_back( Edge( &store, store.add( n1, n2, e.reliability, e.cost ) ) );
+		if ( e.directed )
+			edges.push_back( Edge( &store, store.add( n2, n1, e.reliability, e.cost ) ) );
 	}
-	else
-		return FILE_OPEN_ERROR;
+
+	// The simulations run on a contiguous copy of the adjacency, connectingEdges is only built
+	// if it is asked for
+	buildTopology();
+	return NO_ERROR;
 }
 
 int Graph::loadEdgeData( const char* filename, bool quiet )
 {
 	// CLEANUP: Empty the old vectors first
 	cleanup();
+	finalCleanup();
 	latestEstimatedReliability = -1;
 
-    std::ifstream file( filename );
-    if ( file.is_open() )
-    {
-        // Opening file went oke
+	// The file is mapped and parsed in place in one pass
+	MappedFile file;
+	if ( !file.open( filename ) )
+		return FILE_OPEN_ERROR;
+
+	const char *pos = file.data(), *end = file.end();
+	int lineNumber = 0;
+	std::string_view line;
+	auto nextLine = [&]() {
+		if ( pos >= end )
+			return false;
+		const char *newline = (const char*)memchr( pos, '\n', end-pos );
+		const char *lineEnd = newline ? newline : end;
+		line = std::string_view( pos, lineEnd-pos );
+		if ( !line.empty() && line.back() == '\r' )
+			line.remove_suffix( 1 );
+		pos = newline ? newline+1 : end;
+		++lineNumber;
+		return true;
+	};
+	auto isSpace = []( char c ) {return c == ' ' || c == '\t';};
+
+	// Determine type of the file
+	if ( !nextLine() || line.find("type") == std::string_view::npos )
+	{
+		std::cout << "Incorrect file, could not find a type-specifier\nExample of first line: \"type: edges\"\n";
+		return FILE_OPEN_ERROR;
+	}
+	if ( line.find("edges") == std::string_view::npos )
+	{
+		std::cout << "Could not determine type of file.\n Try looking in the example files on how to do it\n";
+		return FILE_OPEN_ERROR;
+	}
+
+	// Find out the reliability of each node
+	double reliabilityPerNode = 0;
+	size_t probPos;
+	if ( !nextLine() || (probPos = line.find("prob:")) == std::string_view::npos )
+	{
+		std::cout << "No prob-field found in file, aborting\nline: " << line;
+		return FILE_OPEN_ERROR;
+	}
+	const char *c = line.data()+probPos+5, *lineEnd = line.data()+line.size();
+	while ( c < lineEnd && isSpace(*c) )
+		++c;
+	if ( std::from_chars( c, lineEnd, reliabilityPerNode ).ec != std::errc() )
+	{
+		std::cout << filename << ":" << lineNumber << ": could not read the probability in \"" << line << "\"\n";
+		return FILE_OPEN_ERROR;
+	}
 
-        std::string line;
-        getline( file, line );
-        double reliabilityPerNode;
+	// Every remaining line holds at most one edge
+	size_t maxEdges = std::count( pos, end, '\n' ) + 1;
+	edges.reserve( maxEdges );
+	store.reserve( maxEdges );
 
-        // Determine type of the file
-        if ( line.find("type") == std::string::npos )
+	// Start parsing the data. Format of line is "XX YY", blank lines and lines starting with # are skipped.
+	while ( nextLine() )
+	{
+		c = line.data();
+		lineEnd = line.data()+line.size();
+		while ( c < lineEnd && isSpace(*c) )
+			++c;
+		if ( c == lineEnd || *c == '#' )
+			continue;
+
+		int n[2];
+		bool valid = true;
+		for ( int i=0; i<2 && valid; ++i )
 		{
-			std::cout << "Incorrect file, could not find a type-specifier\nExample of first line: \"type: edges\"\n";
+			std::from_chars_result read = std::from_chars( c, lineEnd, n[i] );
+			valid = read.ec == std::errc() && (read.ptr == lineEnd || isSpace(*read.ptr));
+			for ( c = read.ptr; c < lineEnd && isSpace(*c); ++c )
+				;
+		}
+		if ( !valid || c != lineEnd )
+		{
+			std::cout << filename << ":" << lineNumber << ": expected two node ids, found \"" << line << "\"\n";
+			finalCleanup();
 			return FILE_OPEN_ERROR;
 		}
-		int filetype;
-		if ( line.find("edges") != std::string::npos )
-        {
-        	filetype = TYPE_EDGES;
-
-			// Find out the reliability of each node
-			getline( file, line );
-			if ( line.find("prob:") == std::string::npos)
-			{
-				std::cout << "No prob-field found in file, aborting\nline: " << line;
-				return FILE_OPEN_ERROR;
-			}
-			int pos = line.find(" ");
-			line.erase( 0, pos+1 );
-			reliabilityPerNode = atof( line.c_str() );
+		if ( n[0] < 0 || n[1] < 0 )
+		{
+			std::cout << filename << ":" << lineNumber << ": node ids can not be negative, found \"" << line << "\"\n";
+			finalCleanup();
+			return ILLEGAL_NODE_ID;
+		}
 
-			// Start parsing the data
-			while ( file.eof() == 0 )
-			{
-				getline( file, line );
-				if ( line.length() >= 3 && line[0] != '#' )
-				{
-					// Length seems correct, try decoding the edge
-					// Format of line is "XX YY"
-
-					// atoi will read XX and stop at whitespace
-					int n1 = atoi( line.c_str() );
-
-					// For YY we need to find the whitespace first
-					int pos = line.find(" ");
-					line.erase( 0, pos+1 );
-					int n2 = atoi( line.c_str() );
-
-					// Add the edge to our vector
-					Edge* e = new Edge( n1, n2, reliabilityPerNode );
-					edges.push_back( e );
-
-					if (n1>2000 || n2>2000)
-						std::cout << "Large n...\n";
-
-					// For later optimization (let each node know what edges are connecting)
-					// we want to know the largest node id.
-					if ( n1>biggestNodeId )
-						biggestNodeId = n1;
-					if ( n2>biggestNodeId )
-						biggestNodeId = n2;
-				}
-			}
+		// Add the edge to our vector
+		edges.push_back( Edge( &store, store.add( n[0], n[1], reliabilityPerNode ) ) );
 
+		// For later optimization (let each node know what edges are connecting)
+		// we want to know the largest node id.
+		biggestNodeId = std::max( biggestNodeId, std::max( n[0], n[1] ) );
+	}
+	file.close();
 
-        }
-        else
-        {
-        	std::cout << "Could not determine type of file.\n Try looking in the example files on how to do it\n";
-        	return FILE_OPEN_ERROR;
-        }
+	// The simulations run on a contiguous copy of the adjacency, connectingEdges is only built
+	// if it is asked for
+	buildTopology();
 
-        file.close();
+	if ( !quiet )
+	{
+		std::cout << "   Loaded " << edges.size() << " edges\n";
+	}
+	return NO_ERROR;
+}
 
+int Graph::loadSnapshot( const char *filename )
+{
+	cleanup();
+	finalCleanup();
+	latestEstimatedReliability = -1;
 
-        // Given a node, we want to quickly find what edges are connecting to this node
-        // Thus we keep an array of vectors, where each element in the array corresponds
-        // to a node and holds a linked vector with all the connecting edges
-		connectingEdges = new std::vector<Edge*>[biggestNodeId+1];
+	MappedFile file;
+	TopologySnapshot snapshot;
+	if ( readSnapshot( filename, file, &snapshot ) != NO_ERROR )
+		return FILE_OPEN_ERROR;
 
-        // Now, go through edges and put each edge in the right element in connectingEdges
-		std::vector<Edge*>::iterator it;
-		for ( it = edges.begin(); it < edges.end() ; ++it )
-		{
-			//std::cout << (*it)->n[0] << " " << (*it)->n[1] << " " << biggestNodeId <<  std::endl;
-			const int *n = (*it)->getNodes();
-			connectingEdges[ n[0] ].push_back( *it ); // Add a copy of *it to connectingEdges
-			connectingEdges[ n[1] ].push_back( *it );
-		}
+	int E = snapshot.nbrEdges;
+	store.assign( E, snapshot.ends, snapshot.reliability, snapshot.cost );
+	edges.reserve( E );
+	for ( int id=0; id<E; ++id )
+		edges.push_back( Edge( &store, id ) );
+	if ( snapshot.nbrNodes-1 > biggestNodeId )
+		biggestNodeId = snapshot.nbrNodes-1;
 
-		/*for (int i=0; i<=biggestNodeId; ++i)
-		{
-			std::cout << "node "<<i<<" has the following edges\n";
-			for (it = connectingEdges[i].begin(); it < connectingEdges[i].end() ; ++it )
-			{
-				std::cout << (*it)->n[0] << " " << (*it)->n[1] << std::endl;
-			}
-		}*/
+	// The simulations run on a contiguous copy of the adjacency, taken as it is if it was saved
+	if ( snapshot.offsets && snapshot.nbrNodes == biggestNodeId+1 )
+	{
+		topology.assign( snapshot.nbrNodes, E, snapshot.ends, snapshot.offsets, snapshot.neighbors, snapshot.adjEdges );
+		topologyValid = true;
+	}
+	else
+		buildTopology();
+	return NO_ERROR;
+}
 
-		if ( !quiet )
-		{
-			std::cout << "   Loaded " << edges.size() << " edges\n";
-		}
-        return NO_ERROR;
-    }
-    else
-        return FILE_OPEN_ERROR;
+int Graph::saveSnapshot( const char *filename, bool withTopology )
+{
+	const Topology *topo = getTopology();
+	int E = topo->getNbrEdges();
+
+	// Edge k of the snapshot is edge k of the topology
+	std::vector<double> reliability( E );
+	std::vector<float> cost( E );
+	for ( int k=0; k<E; ++k )
+	{
+		reliability[k] = store.getReliabilities()[ topo->getEdgeId(k) ];
+		cost[k] = store.getCosts()[ topo->getEdgeId(k) ];
+	}
+
+	TopologySnapshot snapshot;
+	snapshot.nbrNodes = topo->getNbrNodes();
+	snapshot.nbrEdges = E;
+	snapshot.ends = topo->getEnds();
+	snapshot.reliability = reliability.data();
+	snapshot.cost = cost.data();
+	if ( withTopology )
+	{
+		snapshot.offsets = topo->getOffsets();
+		snapshot.neighbors = topo->getNeighbors();
+		snapshot.adjEdges = topo->getAdjEdges();
+	}
+	return writeSnapshot( filename, snapshot );
+}
+
+int Graph::generateLattice( const LatticeSpec &spec, bool quiet )
+{
+	cleanup();
+	finalCleanup();
+	latestEstimatedReliability = -1;
+
+	std::vector<int> ends;
+	int nbrNodes = ::generateLattice( spec, &ends );
+	if ( nbrNodes == 0 )
+	{
+		std::cout << "Can not generate " << latticeName( spec ) << std::endl;
+		return ILLEGAL_NODE_ID;
+	}
+
+	int E = ends.size()/2;
+	edges.reserve( E );
+	store.reserve( E );
+	for ( int k=0; k<E; ++k )
+		edges.push_back( Edge( &store, store.add( ends[2*k], ends[2*k+1], spec.reliability ) ) );
+	biggestNodeId = std::max( biggestNodeId, nbrNodes-1 );
+	buildTopology();
+
+	if ( !quiet )
+		std::cout << "   Generated " << latticeName( spec ) << " with " << nbrNodes << " nodes and " << E << " edges\n";
+	return NO_ERROR;
 }
 
+void Graph::buildConnectingEdges()
+{
+	// Given a node, we want to quickly find what edges are connecting to this node
+	// Thus we keep an array of vectors, where each element in the array corresponds
+	// to a node and holds a vector with all the connecting edges
+	connectingEdges = new std::vector<Edge>[biggestNodeId+1];
+
+	std::vector<int> degree( biggestNodeId+1, 0 );
+	for ( size_t i=0; i<edges.size(); ++i )
+	{
+		const int *n = edges[i].getNodes();
+		++degree[ n[0] ];
+		++degree[ n[1] ];
+	}
+	for ( int i=0; i<=biggestNodeId; ++i )
+		connectingEdges[i].reserve( degree[i] );
+
+	// Now, go through edges and put each edge in the right element in connectingEdges
+	std::vector<Edge>::iterator it;
+	for ( it = edges.begin(); it < edges.end() ; ++it )
+	{
+		const int *n = it->getNodes();
+		connectingEdges[ n[0] ].push_back( *it ); // Add a copy of *it to connectingEdges
+		connectingEdges[ n[1] ].push_back( *it );
+	}
+}
 
 float Graph::getLatestReliability()
 {
@@ -748,12 +1393,12 @@ float Graph::getLatestReliability()
 void Graph::printEdges()
 {
 	std::cout << "Graph "<<this<<std::endl;
-	std::vector<Edge*>::iterator edgeIt;
+	std::vector<Edge>::iterator edgeIt;
 	for (edgeIt = edges.begin(); edgeIt != edges.end(); ++edgeIt)
 	{
-		int n0 = (*edgeIt)->getConnectingNode();
-		int n1 = (*edgeIt)->getConnectingNode(n0);
-		std::cout <<"  "<< n0 << " "<<n1<<" tau: "<<(*edgeIt)->getTau(1)/(*edgeIt)->getSumTau()<<std::endl;
+		int n0 = edgeIt->getConnectingNode();
+		int n1 = edgeIt->getConnectingNode(n0);
+		std::cout <<"  "<< n0 << " "<<n1<<" tau: "<<edgeIt->getTau(1)/edgeIt->getSumTau()<<std::endl;
 	}
 }
 void Graph::cleanup()
@@ -771,37 +1416,24 @@ void Graph::cleanup()
 
 
 	// DO NOT DELETE EDGES HERE, do it in finalCleanup instaed
-	/*for ( it = edges.begin(); it < edges.end() ; ++it )
-	{
-		delete *it;
-	}
-	edges.clear();
-	*/
+	// (ants reference the edges in the store of the master network)
 }
 
 void Graph::finalCleanup()
 {
-	std::vector<Edge*>::iterator it;
-	for ( it = edges.begin(); it < edges.end() ; ++it )
-	{
-		delete *it;
-	}
 	edges.clear();
+	store.clear();
+	biggestNodeId = 0;
+	topologyValid = false;
 }
 
 
 Graph::Graph()
 {
-
-	if (biggestNodeId != 0)
-	{
-		// The network is already initialized
-		connectingEdges = new std::vector<Edge*>[biggestNodeId+1];
-	}
-	else
-		connectingEdges = 0;
-
+	biggestNodeId = 0;
+	connectingEdges = 0;
 	latestEstimatedReliability = -1;
+	topologyValid = false;
 
 }
 
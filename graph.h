@@ -19,6 +19,12 @@
 #include <vector>
 #include <string>
 #include "MersenneTwister.h"
+#include "montecarlo.h"
+#include "topology.h"
+#include "edgestore.h"
+#include "statistics.h"
+#include "exact.h"
+#include "generator.h"
 #include "lib/cmd_line/src/cmd_line.hpp"
 #include "lib/pugiXML/src/pugixml.hpp"
 
@@ -29,41 +35,49 @@ enum errors {   NO_ERROR=0,
                 ILLEGAL_NODE_ID
 };
 
+/** What the precision of Graph::estReliabilitySequential is relative to */
+enum { RELATIVE_TO_RELIABILITY, RELATIVE_TO_UNRELIABILITY, RELATIVE_TO_SMALLER };
+
 
 
 /** A class representing the edge in our graph.
-    The edge goes both ways. */
+    The edge goes both ways. The data lives in an EdgeStore, an Edge is only
+    a reference to one of its entries and is cheap to copy. */
 class Edge
 {
 public:
-	/** Constructor takes two nodes as argument, and optionally reliability and cost. */
-    Edge( int n1, int n2, float reliability = 0.8, float cost=1.0 );
-	~Edge();
+	/** Constructor takes the store holding the edge and the id of the edge in it. */
+    Edge( EdgeStore *store = 0, int id = -1 ) : store(store), id(id) {};
 
     /** Returns an array with two elements containing the connected nodes. */
-    const int* getNodes() { return n; };
+    const int* getNodes() const { return store->getEnds() + 2*id; };
     /** Return the connected node. */
-	int getConnectingNode( int origin ) { if (origin==n[0]) return n[1]; else return n[0];};
-	int getConnectingNode( ) {return n[0];};
+	int getConnectingNode( int origin ) const { const int *n = getNodes(); if (origin==n[0]) return n[1]; else return n[0];};
+	int getConnectingNode( ) const {return getNodes()[0];};
 
 	/** Reset the edge to working condition if it has failed. If the node is disabled a hard reset must be used.*/
 	void reset();
 	/** Reset the edge no matter the current status. Also resets the pheromones.*/
 	void hardReset();
 	/** Disable the edge, only a hard reset will make it functional again. */
-	void disable() { working = -1;};
+	void disable() { store->getWorking()[id] = -1;};
+
+	bool isWorking() const {return store->getWorking()[id]==1;};
+	bool isDisabled() const {return store->getWorking()[id]==-1;};
+	void setWorking( bool status=1 ) {if (!isDisabled()) store->getWorking()[id] = status;};
 
-	bool isWorking() {return working==1;};
-	void setWorking( bool status=1 ) {if (working != -1) working = status;};
+	/** The id is the index of the edge in its EdgeStore. */
+	int getId() const {return id;};
+	EdgeStore* getStore() const {return store;};
 
-	float getCost() {return cost;};
-	void setReliability( double newReliability ) {reliability = newReliability;};
-	double getReliability() {return reliability;};
+	float getCost() const {return store->getCosts()[id];};
+	void setReliability( double newReliability ) {store->getReliabilities()[id] = newReliability;};
+	double getReliability() const {return store->getReliabilities()[id];};
 
 	/** Get the pheromones on this link for the chosen level. Level=0 means link is not used. */
-	float getTau(int level) {return tau[level];};
+	float getTau(int level) const {return store->getTau(level)[id];};
 	/** Return the sum of the pheromones over all working levels.*/
-	float getSumTau();
+	float getSumTau() const;
 	/** Set the pheromones on this link the chosen level. Level=0 means link is not used. */
 	void setTau(int level, float tau );
 	/** Add a delta tau, use this when iterating over all edges. Then finally apply it with updateTau().*/
@@ -72,26 +86,18 @@ public:
 		rho decides how fast old trails evaporated. */
 	void updateTau( float rho );
 	/** Set the probability to choose this link from origin-node. */
-	void acoSetPFromNode( int origin, float p) {(origin==n[0])? acoP[0]=p: acoP[1]=p;};
+	void acoSetPFromNode( int origin, float p) {store->getAcoP()[2*id + (origin==getNodes()[0] ? 0 : 1)] = p;};
 	/** Get the probability to choose this link from origin-node. */
-	float acoGetPFromNode( int origin ) {if (origin==n[0]) return acoP[0]; else return acoP[1];};
+	float acoGetPFromNode( int origin ) const {return store->getAcoP()[2*id + (origin==getNodes()[0] ? 0 : 1)];};
+
+	bool operator==( const Edge &e ) const {return store==e.store && id==e.id;};
 
 	/** How many levels can the link do? Our problem treats binary (on/off). */
-	const static int maxLevels = 2;
+	const static int maxLevels = EdgeStore::maxLevels;
 
 private:
-	int n[2];
-	int working;	//!< -1 if disabled, 0 if failed and 1 if working
-
-    float cost;
-    double reliability;
-
-
-	float *tau;		//!< The pheromones on this link
-	float *deltaTau;	//!< The new pheromones, not yet applied
-
-	/** acoP[i] is the probability of this link to be chosen from node i */
-	float acoP[2];
+	EdgeStore *store;
+	int id;
 };
 
 
@@ -110,19 +116,44 @@ public:
 	are positive integers which when sorted contain no gaps (i.e. 1 2 3  instead of 1 2 7).
 	Also, it is not allowed to have edges returning to the same node.
 
+	Blank lines and lines starting with # are skipped. Malformed lines are reported with their
+	line number.
+
 	Return NO_ERROR on success. Loading a new network removes the previous network.
 	Optional parameter makes the function quiet unless there's an error. */
     int loadEdgeData( const char* filename, bool quiet=false );
-	int loadEdgeDataFromGraphML(std::string filename, double graphprobabiledge);
-	/** Add an arbitrary edge to the network.
+	/** Load the first graph of a GraphML file. The nodes are numbered in the order they are
+		declared. Edges get their reliability and cost from data keys named reliability and cost,
+		or graphprobabiledge and 1. If streaming the file is scanned without building the DOM,
+		which is faster and takes less memory for large files. Returns NO_ERROR on success. */
+	int loadEdgeDataFromGraphML(std::string filename, double graphprobabiledge, bool streaming=false);
+	/** Load a binary snapshot written by saveSnapshot (see snapshot.h). The arrays are copied
+		from a mapping of the file without any parsing. Returns NO_ERROR on success. */
+	int loadSnapshot( const char *filename );
+	/** Save the network, with its CSR adjacency if withTopology, as a binary snapshot.
+		Disabled edges are saved as working. Returns NO_ERROR on success. */
+	int saveSnapshot( const char *filename, bool withTopology=true );
+	/** Replace the network by the lattice of spec, see generator.h. All links get the reliability
+		of spec and cost 1. Returns ILLEGAL_NODE_ID if the lattice can not be generated. */
+	int generateLattice( const LatticeSpec &spec, bool quiet=false );
+	/** Add an arbitrary edge to the network, its nodes may be new ones.
 		Returns 0 on success and 1 if the edge already exists in this graph. */
-	int addEdge( Edge* e );
+	int addEdge( Edge e );
 
 	int getBiggestNodeId() {return biggestNodeId;};
 
-	std::vector<Edge*>* getConnectingEdges() {return connectingEdges;};
-	std::vector<Edge*>* getConnectingEdges(int n) {return &(connectingEdges[n]);};
-	std::vector<Edge*>* getEdges() {return &edges;};
+	/** The edges of each node, built the first time they are asked for */
+	std::vector<Edge>* getConnectingEdges() {if ( !connectingEdges ) buildConnectingEdges(); return connectingEdges;};
+	std::vector<Edge>* getConnectingEdges(int n) {return &(getConnectingEdges()[n]);};
+	std::vector<Edge>* getEdges() {return &edges;};
+	/** The store holding the edges loaded into this graph. */
+	EdgeStore* getEdgeStore() {return &store;};
+
+	/** CSR snapshot of the network that the simulations run on, edge k is getEdges()[k].
+		Rebuilt when edges have been added since the last call. */
+	const Topology* getTopology();
+	/** Fill p with the probability that each edge in getTopology() works, 0 if disabled. */
+	void getEdgeProbabilities( std::vector<double> *p );
 
 	/** Change the reliability of all edges */
 	void setEdgeReliability( double newReliability );
@@ -139,15 +170,54 @@ public:
 	/** Perform Monte Carlo simulation to estimate the reliability of the network.
 	Takes t as an optional argument which is the number of iterations to calculate.
 	If rawFormat is set to true, no output will be written.
+	mode is one of mcModes and selects the simulation kernel.
+	The samples are spread over threads threads, 0 means the value of setThreads.
+	The edges are not modified, every thread samples into its own buffer.
+	The simulation is seeded from rng, or from randomNbrGenerator if rng is 0. Give each thread
+	its own rng when several networks are evaluated at the same time.
 	Returns the estimated reliability. */
-	float estReliabilityMC(  int t=1000, bool rawFormat=false );
+	float estReliabilityMC(  int t=1000, bool rawFormat=false, int mode=MC_SCALAR, int threads=0, MTRand *rng=0 );
+	/** Monte Carlo simulation that stops when the estimate is good enough.
+	Samples are drawn in batches until the half-width of the Wilson interval at level confidence,
+	relative to R, 1-R or the smaller of them as relativeTo says, is below relHalfWidth, or
+	maxSamples have been drawn. Relative to 1-R a network with rare failures gets its
+	unreliability resolved instead of stopping at the first samples, but takes far more samples.
+	While no sample has fallen on that side, it is below -ln(1-confidence)/n after n samples (the
+	rule of three at 95%), and sampling stops as soon as that is below relHalfWidth.
+	mode and threads are as for estReliabilityMC. */
+	ReliabilityEstimate estReliabilitySequential( double relHalfWidth, double confidence=0.95,
+												  int relativeTo=RELATIVE_TO_RELIABILITY,
+												  long long maxSamples=100000000, bool rawFormat=false,
+												  int mode=MC_BITPARALLEL, int threads=0 );
+	/** Estimate the unreliability 1-R of a highly reliable network with importance sampling,
+	see rareevent.h. t samples are used for the estimate after ceIterations pilot runs that
+	tune the failure probabilities. */
+	UnreliabilityEstimate estUnreliabilityIS( long long t=100000, int ceIterations=5, bool rawFormat=false, int threads=0 );
+	/** Estimate the unreliability 1-R with Lomonosov's turnip from t samples, see rareevent.h.
+	Unlike estUnreliabilityIS it needs no tuning and keeps its relative error bounded, which
+	makes it the choice for ranking networks whose reliabilities are very close. */
+	UnreliabilityEstimate estUnreliabilityTurnip( long long t=100000, bool rawFormat=false, int threads=0 );
+	/** Calculate the reliability exactly with the frontier-based search in exact.h.
+	Feasible for the lattices in data/, returns -1 if the network is too large for it. */
+	double calcReliabilityExact( bool rawFormat=false );
+	/** Compute the reliability polynomial of the edges that are not disabled, see exact.h.
+	Returns false if the network is too large for it. */
+	bool getReliabilityPolynomial( ReliabilityPolynomial *poly );
+	/** Estimate the reliability polynomial of the edges that are not disabled from t samples,
+	for networks too large for getReliabilityPolynomial. See estimatePolynomial in montecarlo.h. */
+	void estReliabilityPolynomial( ReliabilityPolynomial *poly, long long t=100000, int threads=0 );
 	/** Returns the latest estimated reliability.*/
 	float getLatestReliability();
 
 	/** Return the cost of this network.*/
 	float getCost() {return edges.size();};
 
-	/** This must be called on the master network before program terminates to free all memory properly.*/
+	/** Set the default number of threads used by estReliabilityMC. */
+	static void setThreads( int threads );
+	static int getThreads() {return nbrThreads;};
+
+	/** This must be called on the master network before program terminates to free all memory properly.
+		Edges are owned by the store of the master network, ants only reference them.*/
 	void finalCleanup();
 
 
@@ -157,28 +227,89 @@ public:
 
 private:
 
-	/** Helper function for estReliabilityMC, contains the recursion.
-		nc is the current node, and nf is the target. */
-	bool unfoldGraph( int nc, std::vector<Edge*> *connectingEdges, std::vector<bool> *visitedNodes );
+	/** Build the CSR snapshot from edges. Called after loading and when it is outdated. */
+	void buildTopology();
 
-
-    static int biggestNodeId;	//!< Used for keeping track of the nodes (TODO, a vector would be better)
+    int biggestNodeId;			//!< Largest node id of this network, nodes are 0..biggestNodeId
+    static int nbrThreads;		//!< Default number of threads in the Monte Carlo simulations
 
 	void cleanup();		//!< Perform cleanup when done using the graph. Called internally in destructor and load-func.
+	void buildConnectingEdges();	//!< Fill connectingEdges from edges
 
 	float latestEstimatedReliability;
 
-    std::vector<Edge*> *connectingEdges; 	//!< Array of lists of edge*, arranged after nodes
-	std::vector<Edge*> edges;				//!< All edge's
+    std::vector<Edge> *connectingEdges; 	//!< Array of lists of edges, arranged after nodes
+	std::vector<Edge> edges;				//!< All edge's
+	EdgeStore store;						//!< Data of the edges loaded into this graph
+	Topology topology;						//!< Snapshot of edges used by the simulations
+	bool topologyValid;						//!< False if edges has changed since topology was built
 
 };
 
 
 
 
+class ThreadPool;
+
+/** How the colonies of the ACO search exchange solutions */
+enum { MIGRATION_RING, MIGRATION_FULL };
+
+/** Settings of the ACO search. The defaults are the values the search was tuned with. */
+struct AcoParameters
+{
+	float Q;				//!< Determines the deltaTau
+	float rho;				//!< How fast old trails evaporate
+	float b;				//!< Exponent to reliability/bestReliability
+	int MCiterations;		//!< Monte Carlo samples per evaluation when the reliability is not exact
+	int cacheMegabytes;		//!< Memory bound of the cache of evaluated solutions, 0 turns it off
+	bool racing;			//!< Race the Monte Carlo evaluations, dropping ants that are clearly worse early
+
+	/** MAX-MIN Ant System: only the iteration best ant, or every globalBestInterval:th iteration
+		the best ant found so far, lays pheromones, which are kept within [tauMin, tauMax]. tauMax
+		follows the best reliability found, tauMin=minRatio*tauMax. All pheromones are reset to
+		tauMax when the best ant has not improved for restartAfter iterations. */
+	bool mmas;
+	float mmasMinRatio;
+	int mmasGlobalBestInterval;
+	int mmasRestartAfter;
+
+	/** Island model: colonies independent colonies, each with its own pheromones, search in
+		parallel. Every migrationInterval:th iteration each colony is offered the best solution of
+		the colony before it (MIGRATION_RING) or the best of all the others (MIGRATION_FULL) and
+		keeps it if it beats its own best. */
+	int colonies;
+	int migrationInterval;
+	int migration;
+
+	AcoParameters() : Q(1.0), rho(0.80), b(1000), MCiterations(1e4), cacheMegabytes(64), racing(false),
+					  mmas(false), mmasMinRatio(0.01), mmasGlobalBestInterval(5), mmasRestartAfter(25),
+					  colonies(1), migrationInterval(10), migration(MIGRATION_RING) {};
+};
+
+/** What the ACO search found. */
+struct AcoResult
+{
+	double reliability;		//!< Of the best solution, from the final evaluation
+	bool exact;				//!< The reliability was calculated exactly
+	float cost;
+	std::vector<int> links;	//!< Ids of the edges chosen by the best solution
+	int colony;				//!< The colony that found the best solution
+	long long samples;		//!< Monte Carlo samples used by the whole search
+	std::vector<float> colonyReliability;	//!< Best reliability found by each colony
+
+	AcoResult() : reliability(-1), exact(false), cost(0), colony(-1), samples(0) {};
+};
+
 /** Use ACO to find a near-optimal solution that maximizes reliability
 	given a cost restraint of Cmax. */
-int acoFindOptimal( Graph *network, int Nmax,  int nbrAnts=10, int maxEdges=0 );
+int acoFindOptimal( Graph *network, int Nmax,  int nbrAnts=10, int maxEdges=0,
+					const AcoParameters &parameters=AcoParameters(), AcoResult *result=0 );
+
+/** The search of acoFindOptimal on a network whose edges are already reset, with random numbers
+	from rng and parallel loops on pool. If quiet nothing is printed and the network is not changed,
+	so several searches can share one network, once its topology is built. */
+int acoSearch( Graph *network, int Nmax, int nbrAnts, int maxEdges, const AcoParameters &parameters,
+			   MTRand &rng, ThreadPool &pool, AcoResult *result=0, bool quiet=false );
 
 
 
@@ -0,0 +1,459 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <iostream>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include "graphml.h"
+#include "graph.h"
+
+
+static bool isSpace( char c )
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static std::string_view trim( std::string_view text )
+{
+	while ( !text.empty() && isSpace( text.front() ) )
+		text.remove_prefix( 1 );
+	while ( !text.empty() && isSpace( text.back() ) )
+		text.remove_suffix( 1 );
+	return text;
+}
+
+
+
+int GraphMLFile::read( const char *filename, bool streaming, double reliability, float cost )
+{
+	keys.clear();
+	nodes.clear();
+	edges.clear();
+	decoded.clear();
+	defaultReliability = reliability;
+	defaultCost = cost;
+	return streaming ? readStream( filename ) : readDocument( filename );
+}
+
+int GraphMLFile::fieldOf( std::string_view attrName )
+{
+	if ( attrName == "reliability" || attrName == "probability" )
+		return KEY_RELIABILITY;
+	if ( attrName == "cost" )
+		return KEY_COST;
+	return KEY_OTHER;
+}
+
+const GraphMLFile::Key* GraphMLFile::findKey( std::string_view id ) const
+{
+	for ( size_t i=0; i<keys.size(); ++i )
+		if ( keys[i].id == id )
+			return &keys[i];
+	return 0;
+}
+
+bool GraphMLFile::setField( GraphMLEdge &edge, int field, std::string_view text )
+{
+	text = trim( text );
+	const char *end = text.data()+text.size();
+	if ( field == KEY_RELIABILITY )
+		return std::from_chars( text.data(), end, edge.reliability ).ptr == end && !text.empty();
+	if ( field == KEY_COST )
+		return std::from_chars( text.data(), end, edge.cost ).ptr == end && !text.empty();
+	return true;
+}
+
+GraphMLEdge GraphMLFile::newEdge() const
+{
+	GraphMLEdge edge;
+	edge.reliability = defaultReliability;
+	edge.cost = defaultCost;
+	edge.directed = false;
+	for ( size_t i=0; i<keys.size(); ++i )
+		if ( keys[i].forEdges && !keys[i].defaultValue.empty() )
+		{
+			GraphMLEdge withDefault = edge;
+			if ( setField( withDefault, keys[i].field, keys[i].defaultValue ) )
+				edge = withDefault;
+		}
+	return edge;
+}
+
+
+int GraphMLFile::readDocument( const char *filename )
+{
+	pugi::xml_parse_result result = document.load_file( filename );
+	if ( !result )
+	{
+		std::cout << filename << ": " << result.description() << " at byte " << result.offset << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+
+	pugi::xml_node graphml = document.child("graphml");
+	for ( pugi::xml_node key : graphml.children("key") )
+	{
+		std::string_view forWhat = key.attribute("for").as_string();
+		Key k;
+		k.id = key.attribute("id").as_string();
+		k.field = fieldOf( key.attribute("attr.name").as_string() );
+		k.forEdges = forWhat == "edge" || forWhat == "all";
+		k.defaultValue = key.child_value("default");
+		keys.push_back( k );
+	}
+
+	GraphMLEdge defaults = newEdge();
+	for ( pugi::xml_node elem : graphml.child("graph") )
+	{
+		std::string_view name = elem.name();
+		if ( name == "node" )
+			nodes.push_back( elem.attribute("id").as_string() );
+		else if ( name == "edge" )
+		{
+			GraphMLEdge edge = defaults;
+			edge.source = elem.attribute("source").as_string();
+			edge.target = elem.attribute("target").as_string();
+			edge.directed = elem.attribute("directed").as_bool();
+			for ( pugi::xml_node data : elem.children("data") )
+			{
+				const Key *key = findKey( data.attribute("key").as_string() );
+				if ( key && key->forEdges && !setField( edge, key->field, data.child_value() ) )
+				{
+					std::cout << filename << ": edge " << edge.source << "-" << edge.target
+							  << " has the value \"" << data.child_value() << "\" for " << key->id << ", expected a number\n";
+					return FILE_OPEN_ERROR;
+				}
+			}
+			edges.push_back( edge );
+		}
+	}
+	return NO_ERROR;
+}
+
+
+/** Scans the elements of an XML text one by one. Comments, processing instructions, doctypes
+	and the text between elements are skipped, except for the text of elements that are read
+	with text(). */
+class XmlScanner
+{
+public:
+	XmlScanner( const char *begin, const char *end, std::deque<std::string> &decoded )
+		: pos(begin), begin(begin), end(end), decoded(decoded) {};
+
+	/** Move to the next start or end tag. Returns false at the end of the text or on an error. */
+	bool next();
+
+	bool isEnd() const {return closing;};
+	bool isEmpty() const {return selfClosing;};
+	std::string_view getName() const {return name;};
+	/** The value of attribute, empty if it is missing. */
+	std::string_view attribute( std::string_view attribute ) const;
+	/** The text up to the next tag, with CDATA sections and entities resolved. */
+	std::string_view text();
+
+	bool failed() const {return !error.empty();};
+	const std::string& getError() const {return error;};
+	/** Line of the current position */
+	int getLine() const {return 1+std::count( begin, pos, '\n' );};
+
+private:
+	bool fail( const char *message ) {error = message; return false;};
+	/** Replace the predefined and numeric entities in text */
+	std::string_view decode( std::string_view text );
+	const char* find( const char *from, const char *pattern ) const;
+
+	const char *pos;
+	const char *begin;
+	const char *end;
+	std::deque<std::string> &decoded;
+
+	std::string_view name;
+	std::vector< std::pair<std::string_view, std::string_view> > attributes;
+	bool closing;
+	bool selfClosing;
+	std::string error;
+};
+
+const char* XmlScanner::find( const char *from, const char *pattern ) const
+{
+	size_t n = strlen( pattern );
+	for ( const char *p = from; p+n <= end; ++p )
+	{
+		p = (const char*)memchr( p, pattern[0], end-p );
+		if ( p == 0 || p+n > end )
+			return 0;
+		if ( memcmp( p, pattern, n ) == 0 )
+			return p;
+	}
+	return 0;
+}
+
+bool XmlScanner::next()
+{
+	while ( true )
+	{
+		const char *lt = pos < end ? (const char*)memchr( pos, '<', end-pos ) : 0;
+		if ( lt == 0 )
+		{
+			pos = end;
+			return false;
+		}
+		pos = lt;
+
+		const char *skipTo = 0;
+		if ( end-pos >= 4 && memcmp( pos, "<!--", 4 ) == 0 )
+			skipTo = find( pos+4, "-->" );
+		else if ( end-pos >= 9 && memcmp( pos, "<![CDATA[", 9 ) == 0 )
+			skipTo = find( pos+9, "]]>" );
+		else if ( end-pos >= 2 && pos[1] == '?' )
+			skipTo = find( pos+2, "?>" );
+		else if ( end-pos >= 2 && pos[1] == '!' )
+			skipTo = find( pos+2, ">" );
+		else
+			break;
+		if ( skipTo == 0 )
+			return fail( "unterminated comment or declaration" );
+		pos = (const char*)memchr( skipTo, '>', end-skipTo ) + 1;
+	}
+
+	// A start or end tag
+	const char *p = pos+1;
+	closing = p < end && *p == '/';
+	if ( closing )
+		++p;
+	const char *nameStart = p;
+	while ( p < end && !isSpace(*p) && *p != '>' && *p != '/' )
+		++p;
+	name = std::string_view( nameStart, p-nameStart );
+	if ( name.empty() )
+		return fail( "expected the name of an element" );
+
+	attributes.clear();
+	selfClosing = false;
+	while ( true )
+	{
+		while ( p < end && isSpace(*p) )
+			++p;
+		if ( p >= end )
+			return fail( "unterminated tag" );
+		if ( *p == '>' )
+			break;
+		if ( *p == '/' && p+1 < end && p[1] == '>' )
+		{
+			selfClosing = true;
+			++p;
+			break;
+		}
+
+		const char *attributeStart = p;
+		while ( p < end && !isSpace(*p) && *p != '=' && *p != '>' )
+			++p;
+		std::string_view attributeName( attributeStart, p-attributeStart );
+		while ( p < end && isSpace(*p) )
+			++p;
+		if ( p >= end || *p != '=' )
+			return fail( "expected = after an attribute name" );
+		++p;
+		while ( p < end && isSpace(*p) )
+			++p;
+		if ( p >= end || (*p != '"' && *p != '\'') )
+			return fail( "expected a quoted attribute value" );
+		const char *close = (const char*)memchr( p+1, *p, end-p-1 );
+		if ( close == 0 )
+			return fail( "unterminated attribute value" );
+		attributes.push_back( std::make_pair( attributeName, decode( std::string_view( p+1, close-p-1 ) ) ) );
+		p = close+1;
+	}
+	pos = p+1;
+	return true;
+}
+
+std::string_view XmlScanner::attribute( std::string_view attribute ) const
+{
+	for ( size_t i=0; i<attributes.size(); ++i )
+		if ( attributes[i].first == attribute )
+			return attributes[i].second;
+	return std::string_view();
+}
+
+std::string_view XmlScanner::text()
+{
+	// Almost always plain text without CDATA, which is returned as it is
+	const char *lt = (const char*)memchr( pos, '<', end-pos );
+	if ( lt == 0 )
+		lt = end;
+	if ( end-lt < 9 || memcmp( lt, "<![CDATA[", 9 ) != 0 )
+	{
+		std::string_view plain = decode( std::string_view( pos, lt-pos ) );
+		pos = lt;
+		return plain;
+	}
+
+	std::string joined;
+	while ( lt < end )
+	{
+		joined += decode( std::string_view( pos, lt-pos ) );
+		pos = lt;
+		if ( end-pos < 9 || memcmp( pos, "<![CDATA[", 9 ) != 0 )
+			break;
+		const char *close = find( pos+9, "]]>" );
+		if ( close == 0 )
+			close = end;
+		joined.append( pos+9, close );
+		pos = std::min( close+3, end );
+		lt = (const char*)memchr( pos, '<', end-pos );
+		if ( lt == 0 )
+			lt = end;
+	}
+	decoded.push_back( joined );
+	return decoded.back();
+}
+
+std::string_view XmlScanner::decode( std::string_view text )
+{
+	if ( text.find('&') == std::string_view::npos )
+		return text;
+
+	std::string out;
+	for ( size_t i=0; i<text.size(); ++i )
+	{
+		size_t semicolon;
+		if ( text[i] != '&' || (semicolon = text.find( ';', i )) == std::string_view::npos )
+		{
+			out += text[i];
+			continue;
+		}
+		std::string_view entity = text.substr( i+1, semicolon-i-1 );
+		if ( entity == "lt" ) out += '<';
+		else if ( entity == "gt" ) out += '>';
+		else if ( entity == "amp" ) out += '&';
+		else if ( entity == "quot" ) out += '"';
+		else if ( entity == "apos" ) out += '\'';
+		else if ( entity.size() > 1 && entity[0] == '#' )
+		{
+			unsigned int code = 0;
+			bool hex = entity[1] == 'x';
+			std::from_chars( entity.data()+1+hex, entity.data()+entity.size(), code, hex ? 16 : 10 );
+			// UTF-8 of the code point
+			if ( code < 0x80 )
+				out += (char)code;
+			else if ( code < 0x800 )
+			{
+				out += (char)(0xc0 | code>>6);
+				out += (char)(0x80 | (code & 0x3f));
+			}
+			else if ( code < 0x10000 )
+			{
+				out += (char)(0xe0 | code>>12);
+				out += (char)(0x80 | ((code>>6) & 0x3f));
+				out += (char)(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				out += (char)(0xf0 | code>>18);
+				out += (char)(0x80 | ((code>>12) & 0x3f));
+				out += (char)(0x80 | ((code>>6) & 0x3f));
+				out += (char)(0x80 | (code & 0x3f));
+			}
+		}
+		else
+		{
+			out += text[i];
+			continue;
+		}
+		i = semicolon;
+	}
+	decoded.push_back( out );
+	return decoded.back();
+}
+
+int GraphMLFile::readStream( const char *filename )
+{
+	if ( !file.open( filename ) )
+	{
+		std::cout << "Could not open " << filename << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+
+	XmlScanner xml( file.data(), file.end(), decoded );
+	Key *key = 0;				// The key being read
+	GraphMLEdge edge;			// The edge being read
+	bool inEdge = false;
+	GraphMLEdge defaults = newEdge();
+	int graphDepth = 0;			// Like readDocument only the nodes and edges of the first graph are read,
+								// not those of the graphs nested in it or the graphs after it
+
+	while ( xml.next() )
+	{
+		std::string_view name = xml.getName();
+		if ( xml.isEnd() )
+		{
+			if ( name == "graph" && --graphDepth == 0 )
+				break;
+			if ( name == "edge" && inEdge && graphDepth == 1 )
+			{
+				edges.push_back( edge );
+				inEdge = false;
+			}
+			else if ( name == "key" )
+			{
+				key = 0;
+				defaults = newEdge();
+			}
+			continue;
+		}
+
+		if ( name == "graph" )
+		{
+			if ( xml.isEmpty() && graphDepth == 0 )
+				break;
+			graphDepth += !xml.isEmpty();
+		}
+		else if ( name == "node" && graphDepth == 1 )
+			nodes.push_back( xml.attribute("id") );
+		else if ( name == "edge" && graphDepth == 1 )
+		{
+			edge = defaults;
+			edge.source = xml.attribute("source");
+			edge.target = xml.attribute("target");
+			edge.directed = xml.attribute("directed") == "true" || xml.attribute("directed") == "1";
+			inEdge = !xml.isEmpty();
+			if ( !inEdge )
+				edges.push_back( edge );
+		}
+		else if ( name == "data" && inEdge && graphDepth == 1 && !xml.isEmpty() )
+		{
+			const Key *dataKey = findKey( xml.attribute("key") );
+			std::string_view value = xml.text();
+			if ( dataKey && dataKey->forEdges && !setField( edge, dataKey->field, value ) )
+			{
+				std::cout << filename << ":" << xml.getLine() << ": edge " << edge.source << "-" << edge.target
+						  << " has the value \"" << trim( value ) << "\" for " << dataKey->id << ", expected a number\n";
+				return FILE_OPEN_ERROR;
+			}
+		}
+		else if ( name == "key" )
+		{
+			Key k;
+			k.id = xml.attribute("id");
+			k.field = fieldOf( xml.attribute("attr.name") );
+			k.forEdges = xml.attribute("for") == "edge" || xml.attribute("for") == "all";
+			keys.push_back( k );
+			key = xml.isEmpty() ? 0 : &keys.back();
+			if ( !key )
+				defaults = newEdge();
+		}
+		else if ( name == "default" && key && !xml.isEmpty() )
+			key->defaultValue = trim( xml.text() );
+	}
+
+	if ( xml.failed() )
+	{
+		std::cout << filename << ":" << xml.getLine() << ": " << xml.getError() << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+	return NO_ERROR;
+}
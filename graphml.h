@@ -0,0 +1,83 @@
+/** @file graphml.h
+
+	Reading the nodes and edges of GraphML files.
+
+	The file is either parsed into the DOM of pugixml or scanned as a stream straight from a
+	memory mapping. Scanning builds no tree and only keeps the ids of nodes and the edges, so it
+	is the one to use for large files. Both read the same subset of GraphML: keys, and the nodes,
+	edges and data of edges of the first graph, leaving out the graphs nested in it. The reliability and cost of an edge are taken from the data keys with
+	attr.name "reliability" (or "probability") and "cost", from the <default> of those keys, or
+	from the defaults given to read().
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef GRAPHML_H_
+#define GRAPHML_H_
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include "lib/pugiXML/src/pugixml.hpp"
+#include "mappedfile.h"
+
+
+/** An edge as written in the file, its nodes are not resolved yet */
+struct GraphMLEdge
+{
+	std::string_view source;
+	std::string_view target;
+	double reliability;
+	float cost;
+	bool directed;			//!< The edge has directed="true"
+};
+
+class GraphMLFile
+{
+public:
+	/** Read filename, by scanning it if streaming is set. Returns NO_ERROR, or FILE_OPEN_ERROR
+		after printing what is wrong with the file. */
+	int read( const char *filename, bool streaming, double reliability, float cost=1 );
+
+	/** Ids of the nodes in the order of the file. They stay valid as long as this object. */
+	const std::vector<std::string_view>& getNodes() const {return nodes;};
+	const std::vector<GraphMLEdge>& getEdges() const {return edges;};
+
+private:
+	/** What a data key holds */
+	enum { KEY_OTHER, KEY_RELIABILITY, KEY_COST };
+	struct Key
+	{
+		std::string id;
+		int field;
+		bool forEdges;
+		std::string defaultValue;
+	};
+
+	int readDocument( const char *filename );
+	int readStream( const char *filename );
+
+	/** The field of a data key with the name attrName */
+	static int fieldOf( std::string_view attrName );
+	/** Set field of edge from the text of a data element. Returns false if it is not a number. */
+	static bool setField( GraphMLEdge &edge, int field, std::string_view text );
+	/** The edge with the defaults of all keys */
+	GraphMLEdge newEdge() const;
+	const Key* findKey( std::string_view id ) const;
+
+	pugi::xml_document document;
+	MappedFile file;
+	std::deque<std::string> decoded;	//!< Values with entities replaced, the views point here
+
+	std::vector<Key> keys;
+	double defaultReliability;
+	float defaultCost;
+	std::vector<std::string_view> nodes;
+	std::vector<GraphMLEdge> edges;
+};
+
+
+#endif
@@ -14,6 +14,8 @@
 #include <string>
 #include "graph.h"
 #include "misc.h"
+#include "sweep.h"
+#include "batch.h"
 
 
 int main(int argv, char **argc)
@@ -23,17 +25,47 @@ int main(int argv, char **argc)
 
 	double probabil;
 	std::string pathml;
-	int maxCost;
-	int Nmax;
-	int nbrAnts;
+	int maxCost = -1;
+	int Nmax = -1;
+	int nbrAnts = -1;
+	int threads = 0;
+	unsigned int seed = 0;
+	AcoParameters acoParameters;
+	std::string migration = "ring";
+	bool streaming = false;
+	std::string snapshotFile;
+	std::string lattice;
+	std::string batchFile, batchResults = "batch.csv";
+	std::string sweepFile, sweepNmax, sweepAnts, sweepRho, sweepB, sweepQ, sweepSamples;
+	AcoSweep sweep;
 
 	Command_line args;
 
-	args.add_argument({ "-pathMl" }, &pathml, "Path to GrapthMl.");
+	args.add_argument({ "-pathMl" }, &pathml, "Path to GrapthMl, or to a .nwk or .snapshot file. Required unless -generate is given", false);
+	args.add_argument({ "-generate" }, &lattice, "Generate the network instead of loading it, like chain:10, ring:10x2:rot or toroid:100x100:fc (fc: fully connected)", false);
 	args.add_argument({ "-probability" }, &probabil, "Probability of edge reliability");
-	args.add_argument({ "-maxCost" }, &maxCost, "Maximum cost for ants to operate");
-	args.add_argument({ "-Nmax" }, &Nmax, "Maximum number of iterations");
-	args.add_argument({ "-nbrAnts" }, &probabil, "Numers of ants");
+	args.add_argument({ "-streaming" }, &streaming, "Scan the GraphML file as a stream instead of building its DOM, for large files", false);
+	args.add_argument({ "-saveSnapshot" }, &snapshotFile, "Save the loaded network as a binary snapshot to this file and exit, load it again with -pathMl", false);
+	args.add_argument({ "-maxCost" }, &maxCost, "Maximum cost for ants to operate. Required for the ACO search and the sweep", false);
+	args.add_argument({ "-Nmax" }, &Nmax, "Maximum number of iterations. Required for the ACO search and the sweep", false);
+	args.add_argument({ "-nbrAnts" }, &nbrAnts, "Numers of ants. Required for the ACO search and the sweep", false);
+	args.add_argument({ "-threads" }, &threads, "Number of threads in the Monte Carlo simulations, default is all cores", false);
+	args.add_argument({ "-seed" }, &seed, "Seed of the random number generator, runs with the same seed and thread count are identical", false);
+	args.add_argument({ "-racing" }, &acoParameters.racing, "Race the Monte Carlo evaluations of the ants, dropping clearly worse ants early", false);
+	args.add_argument({ "-mmas" }, &acoParameters.mmas, "Use the MAX-MIN Ant System with bounded pheromones and restarts", false);
+	args.add_argument({ "-colonies" }, &acoParameters.colonies, "Number of ant colonies searching in parallel, each with its own pheromones", false);
+	args.add_argument({ "-migrationInterval" }, &acoParameters.migrationInterval, "Iterations between the exchanges of the best solutions of the colonies", false);
+	args.add_argument({ "-migration" }, &migration, "How the colonies exchange solutions: ring (default) or full", false);
+	args.add_argument({ "-sweep" }, &sweepFile, "Sweep the ACO parameters and write the results as CSV to this file", false);
+	args.add_argument({ "-sweepNmax" }, &sweepNmax, "Iterations to sweep over, like 10,20,30", false);
+	args.add_argument({ "-sweepAnts" }, &sweepAnts, "Numbers of ants to sweep over", false);
+	args.add_argument({ "-sweepRho" }, &sweepRho, "Values of rho to sweep over", false);
+	args.add_argument({ "-sweepB" }, &sweepB, "Values of b to sweep over", false);
+	args.add_argument({ "-sweepQ" }, &sweepQ, "Values of Q to sweep over", false);
+	args.add_argument({ "-sweepSamples" }, &sweepSamples, "Monte Carlo samples per evaluation to sweep over", false);
+	args.add_argument({ "-repetitions" }, &sweep.repetitions, "Runs of every combination in the sweep", false);
+	args.add_argument({ "-batch" }, &batchFile, "Evaluate the reliability of every network listed in this manifest instead, see batch.h", false);
+	args.add_argument({ "-batchResults" }, &batchResults, "File the batch results are written to as they finish, CSV or JSON lines if it ends in .json or .jsonl", false);
 
 	args.print_help();
 	//
@@ -44,7 +76,100 @@ int main(int argv, char **argc)
 	//nbrAnts = 2;
 
 	args.parse( argv, argc);
-	int result = acoFindOptimal(&network, Nmax, nbrAnts, maxCost);
+
+	Graph::setThreads( threads );
+	if ( migration == "full" )
+		acoParameters.migration = MIGRATION_FULL;
+	else if ( migration != "ring" )
+	{
+		std::cout << "Unknown migration " << migration << ", use ring or full" << std::endl;
+		return 1;
+	}
+	if ( seed != 0 )
+		randomNbrGenerator.seed( seed );
+
+	if ( !batchFile.empty() )
+	{
+		BatchEntry defaults;
+		defaults.probability = probabil;
+		std::vector<BatchEntry> entries;
+		if ( readBatchManifest( batchFile.c_str(), defaults, &entries ) != NO_ERROR )
+			return FILE_OPEN_ERROR;
+		int result = runBatch( entries, batchResults, threads );
+		if ( result != NO_ERROR )
+			std::cout << "Could not write " << batchResults << std::endl;
+		return result;
+	}
+	// .nwk files and snapshots carry their own probabilities
+	auto hasExtension = [&]( const std::string &extension ) {
+		return pathml.size() > extension.size() && pathml.compare( pathml.size()-extension.size(), extension.size(), extension ) == 0;
+	};
+	int loaded;
+	if ( !lattice.empty() )
+	{
+		LatticeSpec spec;
+		spec.reliability = probabil;
+		if ( !parseLatticeSpec( lattice, &spec ) )
+		{
+			std::cout << "Unknown lattice " << lattice << ", use chain, ring, cylinder or toroid:<cells wide>[x<cells high>][:rot][:fc]" << std::endl;
+			return 1;
+		}
+		loaded = network.generateLattice( spec );
+		pathml = lattice;
+	}
+	else if ( pathml.empty() )
+	{
+		std::cout << "Give the network with -pathMl or -generate" << std::endl;
+		return 1;
+	}
+	else if ( hasExtension( ".nwk" ) )
+		loaded = network.loadEdgeData( pathml.c_str() );
+	else if ( hasExtension( ".snapshot" ) )
+		loaded = network.loadSnapshot( pathml.c_str() );
+	else
+		loaded = network.loadEdgeDataFromGraphML( pathml, probabil, streaming );
+	if ( loaded != NO_ERROR )
+	{
+		std::cout << "Could not load " << pathml << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+
+	if ( !snapshotFile.empty() )
+	{
+		if ( network.saveSnapshot( snapshotFile.c_str() ) != NO_ERROR )
+		{
+			std::cout << "Could not write " << snapshotFile << std::endl;
+			return FILE_OPEN_ERROR;
+		}
+		std::cout << "Saved " << network.getEdges()->size() << " edges to " << snapshotFile << std::endl;
+		return NO_ERROR;
+	}
+
+	if ( maxCost < 0 || Nmax < 0 || nbrAnts < 0 )
+	{
+		std::cout << "Give -maxCost, -Nmax and -nbrAnts" << std::endl;
+		return 1;
+	}
+	if ( !sweepFile.empty() )
+	{
+		if ( (!sweepNmax.empty() && !parseSweepList( sweepNmax, &sweep.Nmax )) ||
+			 (!sweepAnts.empty() && !parseSweepList( sweepAnts, &sweep.nbrAnts )) ||
+			 (!sweepRho.empty() && !parseSweepList( sweepRho, &sweep.rho )) ||
+			 (!sweepB.empty() && !parseSweepList( sweepB, &sweep.b )) ||
+			 (!sweepQ.empty() && !parseSweepList( sweepQ, &sweep.Q )) ||
+			 (!sweepSamples.empty() && !parseSweepList( sweepSamples, &sweep.MCiterations )) )
+		{
+			std::cout << "The sweep values must be comma separated lists like 10,20,30" << std::endl;
+			return 1;
+		}
+		sweep.parameters = acoParameters;
+		int result = acoSweep( &network, sweep, Nmax, nbrAnts, maxCost, sweepFile );
+		if ( result != NO_ERROR )
+			std::cout << "Could not write " << sweepFile << std::endl;
+		return result;
+	}
+
+	int result = acoFindOptimal(&network, Nmax, nbrAnts, maxCost, acoParameters);
 	std::cout << "ACO returned "<<result<<std::endl;
 
 	// ,  
@@ -0,0 +1,112 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+bool MappedFile::open( const char *filename )
+{
+	close();
+	HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+	if ( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) )
+	{
+		CloseHandle( file );
+		return false;
+	}
+	length = (size_t)fileSize.QuadPart;
+	if ( length == 0 )
+	{
+		CloseHandle( file );
+		return true;
+	}
+
+	// The mapping keeps the file open after its handle is closed
+	handle = CreateFileMappingA( file, 0, PAGE_READONLY, 0, 0, 0 );
+	CloseHandle( file );
+	if ( handle == 0 )
+	{
+		length = 0;
+		return false;
+	}
+	bytes = (const char*)MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+	if ( bytes == 0 )
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+	if ( bytes )
+		UnmapViewOfFile( bytes );
+	if ( handle )
+		CloseHandle( handle );
+	bytes = 0;
+	handle = 0;
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open( const char *filename )
+{
+	close();
+	int file = ::open( filename, O_RDONLY );
+	if ( file < 0 )
+		return false;
+
+	struct stat status;
+	if ( fstat( file, &status ) != 0 || !S_ISREG( status.st_mode ) )
+	{
+		::close( file );
+		return false;
+	}
+	length = status.st_size;
+	if ( length == 0 )
+	{
+		::close( file );
+		return true;
+	}
+
+	// The mapping stays valid after the file is closed
+	void *mapped = mmap( 0, length, PROT_READ, MAP_PRIVATE, file, 0 );
+	::close( file );
+	if ( mapped == MAP_FAILED )
+	{
+		length = 0;
+		return false;
+	}
+	madvise( mapped, length, MADV_SEQUENTIAL );
+	bytes = (const char*)mapped;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if ( bytes )
+		munmap( (void*)bytes, length );
+	bytes = 0;
+	length = 0;
+}
+
+#endif
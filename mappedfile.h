@@ -0,0 +1,44 @@
+/** @file mappedfile.h
+
+	Read-only memory mapping of a whole file.
+
+	The loaders parse the mapped bytes directly. There is no copy into a buffer and no stream
+	in between.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+
+
+class MappedFile
+{
+public:
+	MappedFile() : bytes(0), length(0), handle(0) {};
+	~MappedFile() {close();};
+
+	/** Map filename, replacing any file mapped before. Returns false if it can not be opened.
+		An empty file opens with size() 0. */
+	bool open( const char *filename );
+	void close();
+
+	const char* data() const {return bytes;};
+	size_t size() const {return length;};
+	const char* end() const {return bytes+length;};
+
+private:
+	MappedFile( const MappedFile& );
+	MappedFile& operator=( const MappedFile& );
+
+	const char *bytes;
+	size_t length;
+	void *handle;		//!< The mapping object on Windows
+};
+
+
+#endif
@@ -0,0 +1,180 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "montecarlo.h"
+#include "bitparallel.h"
+#include "connectivity.h"
+
+
+int defaultThreadCount()
+{
+	int n = std::thread::hardware_concurrency();
+	if ( n < 1 )
+		n = 1;
+	return n;
+}
+
+int mcWorkerCount( long long t, int threads )
+{
+	long long blocks = (t + MC_BLOCK_SIZE - 1) / MC_BLOCK_SIZE;
+	if ( threads < 1 )
+		threads = 1;
+	if ( blocks < threads )
+		threads = blocks;
+	if ( threads < 1 )
+		threads = 1;
+	return threads;
+}
+
+/** Hand out the blocks of t samples to the workers and call f( block, rng, samples, worker )
+	for each of them. The calling thread is worker 0. */
+static void forEachBlock( long long t, MTRand::uint32 seed, int threads,
+						  const std::function<void( long long, MTRand&, int, int )> &f )
+{
+	long long blocks = (t + MC_BLOCK_SIZE - 1) / MC_BLOCK_SIZE;
+	int workers = mcWorkerCount( t, threads );
+
+	// Blocks are handed out dynamically, every block has its own stream so the order does not matter
+	std::atomic<long long> nextBlock(0);
+	auto worker = [&]( int w )
+	{
+		long long b;
+		while ( (b = nextBlock++) < blocks )
+		{
+			MTRand::uint32 key[2] = { seed, (MTRand::uint32)b };
+			MTRand rng( key, 2 );
+
+			int samples = MC_BLOCK_SIZE;
+			if ( (b+1)*MC_BLOCK_SIZE > t )
+				samples = t - b*MC_BLOCK_SIZE;
+			f( b, rng, samples, w );
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for ( int w=1; w<workers; ++w )
+		pool.push_back( std::thread( worker, w ) );
+	worker( 0 );
+	for ( size_t i=0; i<pool.size(); ++i )
+		pool[i].join();
+}
+
+long long runMonteCarlo( long long t, MTRand::uint32 seed, int threads, const mcKernel &kernel )
+{
+	// The sum of integer counts does not depend on the order of the blocks
+	std::vector<long long> working( mcWorkerCount( t, threads ), 0 );
+	forEachBlock( t, seed, threads, [&]( long long, MTRand &rng, int samples, int w )
+	{
+		working[w] += kernel( rng, samples, w );
+	});
+
+	long long sum = 0;
+	for ( size_t w=0; w<working.size(); ++w )
+		sum += working[w];
+	return sum;
+}
+
+std::vector<double> runMonteCarloSums( long long t, MTRand::uint32 seed, int threads, int nbrSums,
+									   const mcSumKernel &kernel )
+{
+	// Floating point sums depend on the order, so keep the sums of every block
+	// and add them in block order at the end.
+	long long blocks = (t + MC_BLOCK_SIZE - 1) / MC_BLOCK_SIZE;
+	std::vector<double> blockSums( blocks*nbrSums, 0.0 );
+	forEachBlock( t, seed, threads, [&]( long long b, MTRand &rng, int samples, int w )
+	{
+		kernel( rng, samples, w, &blockSums[b*nbrSums] );
+	});
+
+	std::vector<double> sums( nbrSums, 0.0 );
+	for ( long long b=0; b<blocks; ++b )
+		for ( int i=0; i<nbrSums; ++i )
+			sums[i] += blockSums[b*nbrSums + i];
+	return sums;
+}
+
+long long countConnected( const Topology &topo, const std::vector<double> &p, long long t,
+						  MTRand::uint32 seed, int threads, int mode )
+{
+	if ( topo.getNbrNodes() == 0 )
+		return 0;
+
+	int workers = mcWorkerCount( t, threads );
+	if ( mode == MC_BITPARALLEL )
+	{
+		std::vector<BitScratch> scratch( workers );
+		return runMonteCarlo( t, seed, threads, [&]( MTRand &rng, int samples, int w )
+		{
+			return countConnectedBitParallel( topo, p, rng, samples, scratch[w] );
+		});
+	}
+	else if ( mode == MC_UNIONFIND )
+	{
+		std::vector<UnionFind> components( workers );
+		return runMonteCarlo( t, seed, threads, [&]( MTRand &rng, int samples, int w )
+		{
+			return countConnectedUnionFind( topo, p, rng, samples, components[w] );
+		});
+	}
+	else
+	{
+		std::vector<DfsScratch> scratch( workers );
+		return runMonteCarlo( t, seed, threads, [&]( MTRand &rng, int samples, int w )
+		{
+			return countConnectedDFS( topo, p, rng, samples, scratch[w] );
+		});
+	}
+}
+
+void estimatePolynomial( const Topology &topo, const std::vector<double> &p, long long t,
+						 MTRand::uint32 seed, int threads, ReliabilityPolynomial *poly )
+{
+	std::vector<int> enabled;
+	for ( int k=0; k<topo.getNbrEdges(); ++k )
+		if ( p[k] > 0 )
+			enabled.push_back( k );
+	int nbrEdges = enabled.size();
+	const int *ends = topo.getEnds();
+
+	// sums[k] counts the sweeps that became connected with the k:th edge, sums[E+1] those that never did
+	int workers = mcWorkerCount( t, threads );
+	std::vector<UnionFind> components( workers );
+	std::vector< std::vector<int> > orders( workers, enabled );
+	std::vector<double> sums = runMonteCarloSums( t, seed, threads, nbrEdges+2,
+		[&]( MTRand &rng, int samples, int w, double *blockSums )
+	{
+		UnionFind &uf = components[w];
+		std::vector<int> &order = orders[w];
+		for ( int i=0; i<samples; ++i )
+		{
+			uf.reset( topo.getNbrNodes() );
+			int k = 0;
+			if ( uf.getComponents() != 1 )
+				k = nbrEdges+1;
+			// Fisher-Yates, drawing the next edge only when it is needed
+			for ( int j=0; j<nbrEdges && uf.getComponents() > 1; ++j )
+			{
+				std::swap( order[j], order[ j + rng.randInt( nbrEdges-j-1 ) ] );
+				uf.unite( ends[ 2*order[j] ], ends[ 2*order[j]+1 ] );
+				if ( uf.getComponents() == 1 )
+					k = j+1;
+			}
+			++blockSums[k];
+		}
+	});
+
+	std::vector<double> fractions( nbrEdges+1, 0 );
+	double connectedSweeps = 0;
+	for ( int k=0; k<=nbrEdges; ++k )
+	{
+		connectedSweeps += sums[k];
+		fractions[k] = connectedSweeps/t;
+	}
+	poly->setConnectedFractions( fractions );
+}
@@ -0,0 +1,72 @@
+/** @file montecarlo.h
+
+	Driver for running Monte Carlo simulations on several threads.
+
+	The samples of one simulation are split into blocks of MC_BLOCK_SIZE samples.
+	Every block gets its own random stream seeded from (seed, block index), so the
+	result only depends on the seed and never on how the blocks were distributed
+	over the threads.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef MONTECARLO_H_
+#define MONTECARLO_H_
+
+#include <functional>
+#include <vector>
+#include "MersenneTwister.h"
+#include "topology.h"
+#include "exact.h"
+
+/** Kernels that can be used for the all-terminal simulation. */
+enum mcModes {	MC_SCALAR=0,		//!< One sample at a time, depth first search, see connectivity.h
+				MC_BITPARALLEL,		//!< 64 samples per machine word, see bitparallel.h
+				MC_UNIONFIND		//!< One sample at a time, merging components with union-find
+};
+
+/** Number of samples drawn from one random stream. */
+const int MC_BLOCK_SIZE = 1024;
+
+/** A simulation kernel. Called once per block with the random stream of the block,
+	the number of samples to simulate and the index of the calling worker (for picking
+	per-worker scratch buffers). Returns the number of samples with a working network. */
+typedef std::function<long long( MTRand &rng, int samples, int worker )> mcKernel;
+
+/** A kernel for estimators that need more than a count, e.g. weighted samples.
+	Adds its results for the block to sums[0..nbrSums-1], which start at zero. */
+typedef std::function<void( MTRand &rng, int samples, int worker, double *sums )> mcSumKernel;
+
+/** Number of threads used when nothing else is specified, i.e. the number of cores. */
+int defaultThreadCount();
+
+/** The number of workers runMonteCarlo will use for t samples and the wanted number of threads.
+	Use this to allocate the per-worker scratch buffers. */
+int mcWorkerCount( long long t, int threads );
+
+/** Run t samples of kernel on (at most) threads threads.
+	Returns the total number of working samples. */
+long long runMonteCarlo( long long t, MTRand::uint32 seed, int threads, const mcKernel &kernel );
+
+/** Run t samples of kernel on (at most) threads threads and return the nbrSums sums.
+	The sums of the blocks are added in block order, so the result is the same for any thread count. */
+std::vector<double> runMonteCarloSums( long long t, MTRand::uint32 seed, int threads, int nbrSums,
+									   const mcSumKernel &kernel );
+
+/** Simulate t samples of topo where edge k works with probability p[k], using the
+	kernel mode (one of mcModes). Returns the number of samples where all nodes are connected. */
+long long countConnected( const Topology &topo, const std::vector<double> &p, long long t,
+						  MTRand::uint32 seed, int threads, int mode );
+
+/** Estimate the reliability polynomial of the edges of topo with p[k]>0 with t sweeps of the
+	Newman-Ziff algorithm. A sweep adds the edges in random order, merging components with
+	union-find, and notes after how many edges the network became connected. A random subset
+	of k edges is then connected exactly when the sweep connected it within k edges, so one pass
+	gives the connected share for every k, and R(p) for any p follows from poly. */
+void estimatePolynomial( const Topology &topo, const std::vector<double> &p, long long t,
+						 MTRand::uint32 seed, int threads, ReliabilityPolynomial *poly );
+
+
+#endif
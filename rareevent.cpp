@@ -0,0 +1,309 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <cmath>
+#include <algorithm>
+#include "rareevent.h"
+#include "montecarlo.h"
+#include "connectivity.h"
+
+
+/** Fraction of the samples drawn with the untuned start tilt. The cross-entropy tilt tends
+	to concentrate on the cuts it happened to see first, mixing in the start tilt keeps every
+	cut reachable and bounds the weights (defensive importance sampling). */
+const double DEFENSIVE_MIXTURE = 0.3;
+
+/** Simulate t samples where edge k fails with probability tilt[k] instead of 1-p[k], or with
+	probability start[k] for a fraction DEFENSIVE_MIXTURE of the samples.
+	sums[0] and sums[1] get the sum of the weights and squared weights of the disconnected
+	samples. If ce is set, sums[2+k] gets the weight of the disconnected samples where edge
+	k failed, which is what the cross-entropy update needs. */
+static std::vector<double> runTilted( const Topology &topo, const std::vector<double> &p,
+									  const std::vector<double> &tilt, const std::vector<double> &start,
+									  long long t, bool ce, MTRand::uint32 seed, int threads )
+{
+	int nbrEdges = topo.getNbrEdges();
+	const int *ends = topo.getEnds();
+
+	// Log likelihood ratios of a failed and a working edge, for both tilts
+	std::vector<double> logFailed( 2*nbrEdges, 0.0 ), logWorking( 2*nbrEdges, 0.0 );
+	for ( int k=0; k<nbrEdges; ++k )
+	{
+		double q = 1-p[k];
+		if ( q <= 0 || q >= 1 )
+			continue;
+		logFailed[2*k] = std::log( q/tilt[k] );
+		logWorking[2*k] = std::log( (1-q)/(1-tilt[k]) );
+		logFailed[2*k+1] = std::log( q/start[k] );
+		logWorking[2*k+1] = std::log( (1-q)/(1-start[k]) );
+	}
+	const double logMix[2] = { std::log( 1-DEFENSIVE_MIXTURE ), std::log( DEFENSIVE_MIXTURE ) };
+
+	int workers = mcWorkerCount( t, threads );
+	std::vector<UnionFind> components( workers );
+	std::vector<std::vector<char> > failed( workers, std::vector<char>( nbrEdges ) );
+	int nbrSums = ce ? 2+nbrEdges : 2;
+
+	return runMonteCarloSums( t, seed, threads, nbrSums, [&]( MTRand &rng, int samples, int w, double *sums )
+	{
+		UnionFind &uf = components[w];
+		char *fail = failed[w].data();
+		for ( int i=0; i<samples; ++i )
+		{
+			const std::vector<double> &q = (rng.randExc() < DEFENSIVE_MIXTURE) ? start : tilt;
+			uf.reset( topo.getNbrNodes() );
+			double logRatio[2] = { 0, 0 };
+			int k;
+
+			// A connected sample adds nothing, so stop as soon as it is connected
+			for ( k=0; k<nbrEdges && uf.getComponents() > 1; ++k )
+			{
+				fail[k] = rng.randExc() < q[k];
+				if ( fail[k] )
+				{
+					logRatio[0] += logFailed[2*k];
+					logRatio[1] += logFailed[2*k+1];
+				}
+				else
+				{
+					logRatio[0] += logWorking[2*k];
+					logRatio[1] += logWorking[2*k+1];
+					uf.unite( ends[2*k], ends[2*k+1] );
+				}
+			}
+			if ( uf.getComponents() == 1 )
+				continue;
+
+			// weight = f/(mix*g_start + (1-mix)*g_tilt), with the sum taken in log space
+			double a = logMix[0] - logRatio[0], b = logMix[1] - logRatio[1];
+			double m = std::max( a, b );
+			double weight = std::exp( -m - std::log( std::exp( a-m ) + std::exp( b-m ) ) );
+			sums[0] += weight;
+			sums[1] += weight*weight;
+			if ( ce )
+				for ( k=0; k<nbrEdges; ++k )
+					if ( fail[k] )
+						sums[2+k] += weight;
+		}
+	});
+}
+
+UnreliabilityEstimate estimateUnreliabilityIS( const Topology &topo, const std::vector<double> &p, long long t,
+											   int ceIterations, MTRand::uint32 seed, int threads )
+{
+	int nbrEdges = topo.getNbrEdges();
+	MTRand seeds( seed );
+
+	// Start tilt: the weakest node is cut off if all its edges fail, so aim for that many failures
+	int minDegree = nbrEdges;
+	for ( int n=0; n<topo.getNbrNodes(); ++n )
+		minDegree = std::min( minDegree, topo.getOffset(n+1)-topo.getOffset(n) );
+	double start = std::min( 0.5, std::max( 1.0, (double)minDegree )/std::max( 1, nbrEdges ) );
+
+	// Edges that never (or always) fail keep that, the others are only tilted towards failure
+	std::vector<double> startTilt( nbrEdges );
+	for ( int k=0; k<nbrEdges; ++k )
+	{
+		double q = 1-p[k];
+		if ( q <= 0 || q >= 1 )
+			startTilt[k] = q;
+		else
+			startTilt[k] = std::max( q, start );
+	}
+	std::vector<double> tilt = startTilt;
+
+	// Cross-entropy tuning: move the tilt towards the failure frequencies seen in the
+	// disconnected samples, weighted by their likelihood ratio.
+	long long pilot = std::max( (long long)32*MC_BLOCK_SIZE, t/10 );
+	const double smoothing = 0.7;
+	for ( int it=0; it<ceIterations; ++it )
+	{
+		std::vector<double> sums = runTilted( topo, p, tilt, startTilt, pilot, true, seeds.randInt(), threads );
+		for ( int k=0; k<nbrEdges; ++k )
+		{
+			double q = 1-p[k];
+			if ( q <= 0 || q >= 1 )
+				continue;
+			double target;
+			if ( sums[0] > 0 )
+				target = sums[2+k]/sums[0];
+			else
+				target = std::min( 0.5, 2*tilt[k] );	// No disconnected sample, push harder
+			tilt[k] = smoothing*target + (1-smoothing)*tilt[k];
+			tilt[k] = std::min( 0.95, std::max( q, tilt[k] ) );
+		}
+	}
+
+	std::vector<double> sums = runTilted( topo, p, tilt, startTilt, t, false, seeds.randInt(), threads );
+
+	UnreliabilityEstimate est;
+	est.samples = t;
+	est.estimate = sums[0]/t;
+	double variance = sums[1]/t - est.estimate*est.estimate;
+	if ( est.estimate > 0 && t > 1 )
+		est.relativeError = std::sqrt( std::max( 0.0, variance )/(t-1) )/est.estimate;
+	else
+		est.relativeError = 1;
+	return est;
+}
+
+/** Buffers used by the turnip, one per thread. */
+struct TurnipScratch
+{
+	UnionFind uf;
+	std::vector<double> birth;
+	std::vector<int> order;
+	std::vector<std::vector<int> > incident;	//!< Edges leaving each component, indexed by the root
+	std::vector<double> rates;					//!< Total birth rate in each state of the trajectory
+	std::vector<double> state;
+};
+
+/** P(T>1) where T is the time to pass through the states with the given exit rates,
+	a sum of exponential times. Computed by uniformization with rate maxRate and the
+	precomputed Poisson weights of that rate. */
+static double tailProbability( const std::vector<double> &rates, double maxRate,
+							   const std::vector<double> &poisson, std::vector<double> &state )
+{
+	int m = rates.size();
+	if ( m == 0 )
+		return 0;
+	if ( rates[m-1] <= 0 )
+		return 1;	// The network can not get connected
+
+	// state[i] is the probability of being in state i after k uniformized jumps
+	state.assign( m, 0.0 );
+	state[0] = 1;
+	double tail = 0;
+	for ( size_t k=0; k<poisson.size(); ++k )
+	{
+		double transient = 0;
+		for ( int i=0; i<m; ++i )
+			transient += state[i];
+		if ( transient <= 0 )
+			break;
+		tail += poisson[k]*transient;
+
+		for ( int i=std::min( (int)k, m-1 ); i>=0; --i )
+		{
+			double leave = state[i]*rates[i]/maxRate;
+			state[i] -= leave;
+			if ( i+1 < m )
+				state[i+1] += leave;
+		}
+	}
+	return std::min( 1.0, tail );
+}
+
+UnreliabilityEstimate estimateUnreliabilityTurnip( const Topology &topo, const std::vector<double> &p, long long t,
+												   MTRand::uint32 seed, int threads )
+{
+	int nbrNodes = topo.getNbrNodes();
+	int nbrEdges = topo.getNbrEdges();
+	const int *ends = topo.getEnds();
+
+	// Birth rates. Perfect edges are born at time 0 and contracted before sampling,
+	// edges that never work have rate 0 and are left out.
+	std::vector<double> lambda( nbrEdges, 0.0 );
+	UnionFind contracted( nbrNodes );
+	double totalRate = 0;
+	for ( int k=0; k<nbrEdges; ++k )
+		if ( p[k] >= 1 )
+			contracted.unite( ends[2*k], ends[2*k+1] );
+	for ( int k=0; k<nbrEdges; ++k )
+		if ( p[k] > 0 && p[k] < 1 && contracted.find( ends[2*k] ) != contracted.find( ends[2*k+1] ) )
+		{
+			lambda[k] = -std::log( 1-p[k] );
+			totalRate += lambda[k];
+		}
+
+	// The rate is largest before the first birth, so that is the uniformization rate.
+	// The Poisson weights are the same for every sample.
+	std::vector<double> poisson;
+	int jumps = (int)( totalRate + 12*std::sqrt( totalRate ) + 30 );
+	for ( int k=0; k<=jumps; ++k )
+		poisson.push_back( std::exp( -totalRate + k*std::log( std::max( totalRate, 1e-300 ) ) - std::lgamma( k+1.0 ) ) );
+
+	std::vector<TurnipScratch> scratch( mcWorkerCount( t, threads ) );
+	std::vector<double> sums = runMonteCarloSums( t, seed, threads, 2, [&]( MTRand &rng, int samples, int w, double *sums )
+	{
+		TurnipScratch &s = scratch[w];
+		s.birth.resize( nbrEdges );
+		s.incident.resize( nbrNodes );
+
+		for ( int i=0; i<samples; ++i )
+		{
+			// Start from the contracted network, every component knows its outgoing edges
+			s.uf.reset( nbrNodes );
+			for ( int k=0; k<nbrEdges; ++k )
+				if ( p[k] >= 1 )
+					s.uf.unite( ends[2*k], ends[2*k+1] );
+			for ( int n=0; n<nbrNodes; ++n )
+				s.incident[n].clear();
+			s.order.clear();
+			for ( int k=0; k<nbrEdges; ++k )
+				if ( lambda[k] > 0 )
+				{
+					s.incident[ s.uf.find( ends[2*k] ) ].push_back( k );
+					s.incident[ s.uf.find( ends[2*k+1] ) ].push_back( k );
+					s.birth[k] = -std::log( rng.randDblExc() )/lambda[k];
+					s.order.push_back( k );
+				}
+			std::sort( s.order.begin(), s.order.end(), [&]( int a, int b ) {return s.birth[a] < s.birth[b];} );
+
+			// Follow the births in time order. The first edge between two components is the next
+			// merge, and all edges between the two merged components stop counting.
+			double rate = totalRate;
+			s.rates.clear();
+			for ( size_t j=0; j<s.order.size() && s.uf.getComponents() > 1; ++j )
+			{
+				int k = s.order[j];
+				int a = s.uf.find( ends[2*k] ), b = s.uf.find( ends[2*k+1] );
+				if ( a == b )
+					continue;
+				s.rates.push_back( rate );
+
+				// Scan the smaller edge list, keep the edges that still leave the new component
+				if ( s.incident[a].size() > s.incident[b].size() )
+					std::swap( a, b );
+				std::vector<int> &small = s.incident[a];
+				std::vector<int> &large = s.incident[b];
+				for ( size_t l=0; l<small.size(); ++l )
+				{
+					int e = small[l];
+					int ra = s.uf.find( ends[2*e] ), rb = s.uf.find( ends[2*e+1] );
+					if ( ra == rb )
+						continue;	// Already inside a, and already subtracted
+					if ( (ra == a && rb == b) || (ra == b && rb == a) )
+						rate -= lambda[e];
+					else
+						large.push_back( e );
+				}
+				small.clear();
+				s.uf.unite( a, b );
+				int root = s.uf.find( a );
+				if ( root != b )
+					std::swap( s.incident[root], s.incident[b] );
+			}
+			// If edges ran out before the network got connected it stays in a state with rate 0
+			if ( s.uf.getComponents() > 1 )
+				s.rates.push_back( 0 );
+
+			double x = tailProbability( s.rates, totalRate, poisson, s.state );
+			sums[0] += x;
+			sums[1] += x*x;
+		}
+	});
+
+	UnreliabilityEstimate est;
+	est.samples = t;
+	est.estimate = sums[0]/t;
+	double variance = sums[1]/t - est.estimate*est.estimate;
+	if ( est.estimate > 0 && t > 1 )
+		est.relativeError = std::sqrt( std::max( 0.0, variance )/(t-1) )/est.estimate;
+	else
+		est.relativeError = 1;
+	return est;
+}
@@ -0,0 +1,41 @@
+/** @file rareevent.h
+
+	Estimators for the unreliability 1-R of highly reliable networks, where almost
+	every sample of the plain Monte Carlo simulation is a connected network.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef RAREEVENT_H_
+#define RAREEVENT_H_
+
+#include <vector>
+#include "MersenneTwister.h"
+#include "topology.h"
+#include "statistics.h"
+
+/** Importance sampling estimate of 1-R for topo where edge k works with probability p[k].
+	Edges fail with tilted probabilities in the simulation and every disconnected sample is
+	weighted with its likelihood ratio, which keeps the estimate unbiased.
+	The tilt starts at the degree of the weakest node divided by the number of edges and is
+	then tuned with ceIterations pilot runs of the cross-entropy method. The pilot samples
+	are not part of the returned estimate. A share of all samples keeps using the start tilt,
+	since the tuned one may have lost some of the cuts the pilot runs did not see. */
+UnreliabilityEstimate estimateUnreliabilityIS( const Topology &topo, const std::vector<double> &p, long long t,
+											   int ceIterations, MTRand::uint32 seed, int threads );
+
+/** Lomonosov's turnip estimate of 1-R for topo where edge k works with probability p[k].
+	Every edge is born after an exponential time with rate -ln(1-p[k]), so it exists at time 1
+	with probability p[k]. A sample draws the order in which edges join components (edges inside
+	a component are dropped), and the probability that the network is still not connected at
+	time 1 given the sequence of total birth rates is computed exactly. The average of these
+	probabilities has bounded relative error when 1-R is small. Each sample costs one sort and one
+	union-find pass over the edges plus a uniformization sum that grows with the total birth rate,
+	so it is meant for small and medium networks. */
+UnreliabilityEstimate estimateUnreliabilityTurnip( const Topology &topo, const std::vector<double> &p, long long t,
+												   MTRand::uint32 seed, int threads );
+
+
+#endif
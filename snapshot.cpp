@@ -0,0 +1,163 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include "snapshot.h"
+#include "graph.h"
+
+
+static const char snapshotMagic[8] = { 'N', 'W', 'K', 'S', 'N', 'A', 'P', 0 };
+
+/** Bytes of an array of n items of size bytes, padded to 8 */
+static size_t padded( size_t n, size_t size )
+{
+	return (n*size + 7) & ~(size_t)7;
+}
+
+/** Checksum of the bytes, 8 at a time, mixed like splitmix64 */
+static uint64_t checksumOf( const char *data, size_t length )
+{
+	uint64_t h = length;
+	size_t i = 0;
+	for ( ; i+8 <= length; i += 8 )
+	{
+		uint64_t x;
+		memcpy( &x, data+i, 8 );
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		h = (h ^ x ^ (x >> 31)) * 0x9e3779b97f4a7c15ULL;
+	}
+	for ( ; i<length; ++i )
+		h = (h ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+/** Size of everything after the header */
+static size_t payloadSize( uint64_t nbrNodes, uint64_t nbrEdges, bool csr )
+{
+	size_t size = padded( 2*nbrEdges, sizeof(int) ) + padded( nbrEdges, sizeof(double) ) + padded( nbrEdges, sizeof(float) );
+	if ( csr )
+		size += padded( nbrNodes+1, sizeof(int) ) + 2*padded( 2*nbrEdges, sizeof(int) );
+	return size;
+}
+
+
+int writeSnapshot( const char *filename, const TopologySnapshot &snapshot, bool checksum )
+{
+	bool csr = snapshot.offsets != 0;
+	int E = snapshot.nbrEdges, N = snapshot.nbrNodes;
+
+	// The payload is put together in memory, which is as large as the network itself
+	std::vector<char> payload( payloadSize( N, E, csr ), 0 );
+	char *p = payload.data();
+	auto append = [&]( const void *data, size_t n, size_t size ) {
+		if ( n > 0 )
+			memcpy( p, data, n*size );
+		p += padded( n, size );
+	};
+	append( snapshot.ends, 2*E, sizeof(int) );
+	append( snapshot.reliability, E, sizeof(double) );
+	append( snapshot.cost, E, sizeof(float) );
+	if ( csr )
+	{
+		append( snapshot.offsets, N+1, sizeof(int) );
+		append( snapshot.neighbors, 2*E, sizeof(int) );
+		append( snapshot.adjEdges, 2*E, sizeof(int) );
+	}
+
+	SnapshotHeader header;
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, snapshotMagic, 8 );
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrder = 0x01020304;
+	header.flags = (csr ? SNAPSHOT_CSR : 0) | (checksum ? SNAPSHOT_CHECKSUM : 0);
+	header.nbrNodes = N;
+	header.nbrEdges = E;
+	header.checksum = checksum ? checksumOf( payload.data(), payload.size() ) : 0;
+
+	std::ofstream file( filename, std::ios::out|std::ios::binary|std::ios::trunc );
+	file.write( (const char*)&header, sizeof(header) );
+	file.write( payload.data(), payload.size() );
+	file.close();
+	return file ? NO_ERROR : FILE_OPEN_ERROR;
+}
+
+int readSnapshot( const char *filename, MappedFile &file, TopologySnapshot *snapshot )
+{
+	if ( !file.open( filename ) )
+	{
+		std::cout << "Could not open " << filename << std::endl;
+		return FILE_OPEN_ERROR;
+	}
+
+	auto invalid = [&]( const char *reason ) {
+		std::cout << filename << ": " << reason << std::endl;
+		file.close();
+		return FILE_OPEN_ERROR;
+	};
+
+	SnapshotHeader header;
+	if ( file.size() < sizeof(header) )
+		return invalid( "too short for a snapshot" );
+	memcpy( &header, file.data(), sizeof(header) );
+	if ( memcmp( header.magic, snapshotMagic, 8 ) != 0 )
+		return invalid( "not a network snapshot" );
+	if ( header.byteOrder != 0x01020304 )
+		return invalid( "snapshot written on a machine with another byte order" );
+	if ( header.version != SNAPSHOT_VERSION )
+		return invalid( "unknown snapshot version" );
+	if ( header.nbrNodes > 0x7fffffff || header.nbrEdges > 0x3fffffff || (header.nbrEdges > 0 && header.nbrNodes == 0) )
+		return invalid( "snapshot has an impossible number of nodes or edges" );
+
+	bool csr = header.flags & SNAPSHOT_CSR;
+	const char *payload = file.data() + sizeof(header);
+	size_t size = file.size() - sizeof(header);
+	if ( size != payloadSize( header.nbrNodes, header.nbrEdges, csr ) )
+		return invalid( "snapshot has the wrong size, it may be truncated" );
+	if ( (header.flags & SNAPSHOT_CHECKSUM) && checksumOf( payload, size ) != header.checksum )
+		return invalid( "snapshot checksum does not match, the file is damaged" );
+
+	// The header is 64 bytes and every array is padded to 8, so they are all aligned
+	int N = header.nbrNodes, E = header.nbrEdges;
+	*snapshot = TopologySnapshot();
+	snapshot->nbrNodes = N;
+	snapshot->nbrEdges = E;
+	const char *p = payload;
+	snapshot->ends = (const int*)p;
+	p += padded( 2*E, sizeof(int) );
+	snapshot->reliability = (const double*)p;
+	p += padded( E, sizeof(double) );
+	snapshot->cost = (const float*)p;
+	p += padded( E, sizeof(float) );
+	if ( csr )
+	{
+		snapshot->offsets = (const int*)p;
+		p += padded( N+1, sizeof(int) );
+		snapshot->neighbors = (const int*)p;
+		p += padded( 2*E, sizeof(int) );
+		snapshot->adjEdges = (const int*)p;
+	}
+
+	// Without these checks a damaged file without checksum would index out of bounds later
+	for ( int k=0; k<2*E; ++k )
+		if ( snapshot->ends[k] < 0 || snapshot->ends[k] >= N )
+			return invalid( "snapshot has an edge to a node that does not exist" );
+	if ( csr )
+	{
+		bool valid = snapshot->offsets[0] == 0 && snapshot->offsets[N] == 2*E;
+		for ( int n=0; n<N && valid; ++n )
+			valid = snapshot->offsets[n] <= snapshot->offsets[n+1];
+		for ( int j=0; j<2*E && valid; ++j )
+			valid = snapshot->neighbors[j] >= 0 && snapshot->neighbors[j] < N &&
+					snapshot->adjEdges[j] >= 0 && snapshot->adjEdges[j] < E;
+		if ( !valid )
+			return invalid( "snapshot has a broken adjacency" );
+	}
+	return NO_ERROR;
+}
@@ -0,0 +1,65 @@
+/** @file snapshot.h
+
+	Binary snapshots of networks, for loading a network without parsing it.
+
+	A snapshot is a 64 byte header followed by arrays in the byte order of the machine that
+	wrote it, each padded to a multiple of 8 bytes:
+		int32 ends[2E], double reliability[E], float cost[E]
+	and if the header has SNAPSHOT_CSR the adjacency of the Topology class:
+		int32 offsets[N+1], int32 neighbors[2E], int32 adjEdges[2E]
+	If the header has SNAPSHOT_CHECKSUM, its checksum covers everything after the header. Files
+	of a different version or byte order are rejected, newer versions change the version number.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstdint>
+#include "mappedfile.h"
+
+
+const uint32_t SNAPSHOT_VERSION = 1;
+
+enum snapshotFlags { SNAPSHOT_CSR=1, SNAPSHOT_CHECKSUM=2 };
+
+struct SnapshotHeader
+{
+	char magic[8];			//!< "NWKSNAP" and a 0
+	uint32_t version;
+	uint32_t byteOrder;		//!< 0x01020304 as written by the saving machine
+	uint32_t flags;			//!< snapshotFlags
+	uint32_t reserved;
+	uint64_t nbrNodes;
+	uint64_t nbrEdges;
+	uint64_t checksum;
+	uint64_t reserved2[2];
+};
+
+/** The arrays of a network. After readSnapshot they point into the mapped file. */
+struct TopologySnapshot
+{
+	int nbrNodes;
+	int nbrEdges;
+	const int *ends;
+	const double *reliability;
+	const float *cost;
+	const int *offsets;		//!< The CSR arrays are 0 if the snapshot has none
+	const int *neighbors;
+	const int *adjEdges;
+
+	TopologySnapshot() : nbrNodes(0), nbrEdges(0), ends(0), reliability(0), cost(0), offsets(0), neighbors(0), adjEdges(0) {};
+};
+
+/** Write snapshot to filename, with the CSR arrays if it has them. Returns NO_ERROR or FILE_OPEN_ERROR. */
+int writeSnapshot( const char *filename, const TopologySnapshot &snapshot, bool checksum=true );
+
+/** Map filename into file, check it and point snapshot at its arrays, which stay valid while
+	file is open. Prints what is wrong and returns FILE_OPEN_ERROR if it is not a valid snapshot. */
+int readSnapshot( const char *filename, MappedFile &file, TopologySnapshot *snapshot );
+
+
+#endif
@@ -0,0 +1,77 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <cmath>
+#include <algorithm>
+#include "statistics.h"
+
+
+double normalQuantile( double p )
+{
+	// Rational approximation by P. J. Acklam followed by one step of Halley's method,
+	// which gives full double precision.
+	static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+								 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+	static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+								 6.680131188771972e+01, -1.328068155288572e+01 };
+	static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+								-2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+	static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+								3.754408661907416e+00 };
+	const double pLow = 0.02425;
+
+	if ( p <= 0 )
+		return -HUGE_VAL;
+	if ( p >= 1 )
+		return HUGE_VAL;
+
+	double x;
+	if ( p < pLow )
+	{
+		double q = std::sqrt( -2*std::log(p) );
+		x = (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	}
+	else if ( p <= 1-pLow )
+	{
+		double q = p-0.5;
+		double r = q*q;
+		x = (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q / (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1);
+	}
+	else
+	{
+		double q = std::sqrt( -2*std::log(1-p) );
+		x = -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+	}
+
+	double e = 0.5*std::erfc( -x/std::sqrt(2.0) ) - p;
+	double u = e*2.50662827463100050242*std::exp( x*x/2 );	// sqrt(2 pi)
+	return x - u/(1 + x*u/2);
+}
+
+ReliabilityEstimate wilsonInterval( long long successes, long long n, double confidence )
+{
+	ReliabilityEstimate r;
+	r.confidence = confidence;
+	r.samples = n;
+	if ( n <= 0 )
+	{
+		r.estimate = 0;
+		r.lower = 0;
+		r.upper = 1;
+		return r;
+	}
+
+	double z = normalQuantile( 0.5 + confidence/2 );
+	double p = (double)successes/n;
+	double z2n = z*z/n;
+	double center = (p + z2n/2)/(1 + z2n);
+	double halfWidth = z*std::sqrt( p*(1-p)/n + z2n/(4*n) )/(1 + z2n);
+
+	r.estimate = p;
+	r.lower = std::max( 0.0, center-halfWidth );
+	r.upper = std::min( 1.0, center+halfWidth );
+	return r;
+}
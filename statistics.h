@@ -0,0 +1,40 @@
+/** @file statistics.h
+
+	Confidence intervals for the reliability estimates.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+
+/** An estimated reliability together with its confidence interval. */
+struct ReliabilityEstimate
+{
+	double estimate;		//!< The estimated reliability
+	double lower;			//!< Lower end of the confidence interval
+	double upper;			//!< Upper end of the confidence interval
+	double confidence;		//!< Confidence level of the interval, e.g. 0.95
+	long long samples;		//!< Number of samples the estimate is based on
+};
+
+/** An estimated unreliability 1-R from one of the rare event estimators. */
+struct UnreliabilityEstimate
+{
+	double estimate;		//!< The estimated unreliability 1-R
+	double relativeError;	//!< Standard error of the estimate divided by the estimate
+	long long samples;		//!< Number of samples the estimate is based on
+};
+
+/** The x such that P(Z<x)=p for a standard normal Z. */
+double normalQuantile( double p );
+
+/** Wilson score interval for successes out of n Bernoulli trials at the given confidence level.
+	Returns an estimate with estimate=successes/n. */
+ReliabilityEstimate wilsonInterval( long long successes, long long n, double confidence );
+
+
+#endif
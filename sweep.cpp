@@ -0,0 +1,163 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "sweep.h"
+#include "misc.h"
+#include "threadpool.h"
+
+
+template <class T>
+static bool parseList( const std::string &text, std::vector<T> *values )
+{
+	values->clear();
+	std::stringstream stream( text );
+	std::string item;
+	while ( std::getline( stream, item, ',' ) )
+	{
+		std::stringstream itemStream( item );
+		T value;
+		if ( !(itemStream >> value) || !(itemStream >> std::ws).eof() )
+			return false;
+		values->push_back( value );
+	}
+	return !values->empty();
+}
+
+bool parseSweepList( const std::string &text, std::vector<int> *values )
+{
+	return parseList( text, values );
+}
+
+bool parseSweepList( const std::string &text, std::vector<float> *values )
+{
+	return parseList( text, values );
+}
+
+
+/** One combination of the swept values */
+struct SweepPoint
+{
+	AcoParameters parameters;
+	int Nmax;
+	int nbrAnts;
+};
+
+/** What one run of a combination gave */
+struct SweepRun
+{
+	AcoResult result;
+	double seconds;
+};
+
+int acoSweep( Graph *network, const AcoSweep &sweep, int Nmax, int nbrAnts, int maxEdges,
+			  const std::string &filename )
+{
+	std::ofstream file( filename.c_str(), std::ios::out|std::ios::trunc );
+	if ( !file )
+		return FILE_OPEN_ERROR;
+
+	const AcoParameters &base = sweep.parameters;
+	std::vector<int> Nmaxs = sweep.Nmax.empty() ? std::vector<int>( 1, Nmax ) : sweep.Nmax;
+	std::vector<int> ants = sweep.nbrAnts.empty() ? std::vector<int>( 1, nbrAnts ) : sweep.nbrAnts;
+	std::vector<float> rhos = sweep.rho.empty() ? std::vector<float>( 1, base.rho ) : sweep.rho;
+	std::vector<float> bs = sweep.b.empty() ? std::vector<float>( 1, base.b ) : sweep.b;
+	std::vector<float> Qs = sweep.Q.empty() ? std::vector<float>( 1, base.Q ) : sweep.Q;
+	std::vector<int> samples = sweep.MCiterations.empty() ? std::vector<int>( 1, base.MCiterations ) : sweep.MCiterations;
+	int repetitions = std::max( sweep.repetitions, 1 );
+
+	ThreadPool pool( Graph::getThreads() );
+
+	// All runs share the network, so it is reset and its topology built before any of them starts
+	network->hardResetEdges();
+	network->getTopology();
+
+	std::vector<SweepPoint> points;
+	for ( size_t i=0; i<Nmaxs.size(); ++i )
+		for ( size_t j=0; j<ants.size(); ++j )
+			for ( size_t k=0; k<rhos.size(); ++k )
+				for ( size_t l=0; l<bs.size(); ++l )
+					for ( size_t m=0; m<Qs.size(); ++m )
+						for ( size_t n=0; n<samples.size(); ++n )
+						{
+							SweepPoint point;
+							point.parameters = base;
+							point.parameters.rho = rhos[k];
+							point.parameters.b = bs[l];
+							point.parameters.Q = Qs[m];
+							point.parameters.MCiterations = samples[n];
+							// The runs on the threads share the memory of one cache
+							if ( base.cacheMegabytes > 0 )
+								point.parameters.cacheMegabytes = std::max( base.cacheMegabytes/pool.getThreads(), 1 );
+							point.Nmax = Nmaxs[i];
+							point.nbrAnts = ants[j];
+							points.push_back( point );
+						}
+
+	// Run r is repetition r%repetitions of point r/repetitions. The threads take the runs that
+	// build and evaluate the most ants first, so no long run is left alone at the end.
+	long long nbrRuns = (long long)points.size()*repetitions;
+	std::vector<long long> order( nbrRuns );
+	for ( long long r=0; r<nbrRuns; ++r )
+		order[r] = r;
+	auto work = [&]( long long r ) {
+		const SweepPoint &point = points[ r/repetitions ];
+		return (double)point.Nmax*point.nbrAnts*point.parameters.MCiterations;
+	};
+	std::stable_sort( order.begin(), order.end(), [&]( long long r1, long long r2 ) {return work(r1) > work(r2);} );
+
+	std::cout << "Sweeping " << points.size() << " combinations " << repetitions << " times each\n";
+	MTRand::uint32 sweepSeed = randomNbrGenerator.randInt();
+	std::vector<SweepRun> runs( nbrRuns );
+	Progress progress( "Percentage done", nbrRuns );
+	pool.parallelFor( nbrRuns, [&]( long long i, int )
+	{
+		long long r = order[i];
+		const SweepPoint &point = points[ r/repetitions ];
+		MTRand::uint32 key[2] = { sweepSeed, (MTRand::uint32)r };
+		MTRand rng( key, 2 );
+
+		auto start = std::chrono::steady_clock::now();
+		acoSearch( network, point.Nmax, point.nbrAnts, maxEdges, point.parameters, rng, pool, &runs[r].result, true );
+		runs[r].seconds = std::chrono::duration<double>( std::chrono::steady_clock::now()-start ).count();
+		progress.advance();
+	});
+	progress.finish();
+
+	file << "Nmax,nbrAnts,rho,b,Q,MCiterations,runs,Rmean,Rmax,Rstd,exactRuns,seconds,samples\n";
+	for ( size_t p=0; p<points.size(); ++p )
+	{
+		double sum = 0, sumSquares = 0, max = 0, seconds = 0, nbrSamples = 0;
+		int exactRuns = 0;
+		for ( int r=p*repetitions; r<(int)(p+1)*repetitions; ++r )
+		{
+			double R = runs[r].result.reliability;
+			sum += R;
+			sumSquares += R*R;
+			max = std::max( max, R );
+			exactRuns += runs[r].result.exact;
+			seconds += runs[r].seconds;
+			nbrSamples += runs[r].result.samples;
+		}
+		double mean = sum/repetitions;
+		double deviation = repetitions > 1 ? std::sqrt( std::max( 0.0, (sumSquares-repetitions*mean*mean)/(repetitions-1) ) ) : 0;
+
+		const SweepPoint &point = points[p];
+		file << point.Nmax << "," << point.nbrAnts << "," << point.parameters.rho << "," << point.parameters.b << ","
+			 << point.parameters.Q << "," << point.parameters.MCiterations << "," << repetitions << ","
+			 << mean << "," << max << "," << deviation << "," << exactRuns << ","
+			 << seconds/repetitions << "," << (long long)(nbrSamples/repetitions + 0.5) << "\n";
+	}
+	file.close();
+
+	std::cout << "Wrote " << points.size() << " rows to " << filename << std::endl;
+	return file ? NO_ERROR : FILE_OPEN_ERROR;
+}
@@ -0,0 +1,50 @@
+/** @file sweep.h
+
+	Sweeps over the parameters of the ACO search in a single process.
+
+	Every combination of the listed values is searched a number of times on the same network,
+	which is loaded once. The runs are spread over a thread pool, the longest first, and each run
+	has its own random stream seeded from the global generator and the index of the run, so the
+	results only depend on the seed. The mean and best reliability, the time and the Monte Carlo
+	samples of each combination are written as one row of a CSV file.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <vector>
+#include <string>
+#include "graph.h"
+
+
+/** The values to sweep over. Empty lists use the value in parameters, or for Nmax and nbrAnts
+	the values given to acoSweep. */
+struct AcoSweep
+{
+	std::vector<int> Nmax;				//!< Iterations
+	std::vector<int> nbrAnts;
+	std::vector<float> rho;
+	std::vector<float> b;
+	std::vector<float> Q;
+	std::vector<int> MCiterations;		//!< Monte Carlo samples per evaluation
+	int repetitions;					//!< Runs of every combination
+	AcoParameters parameters;			//!< Everything that is not swept
+
+	AcoSweep() : repetitions(1) {};
+};
+
+/** Parse a comma separated list like "10,20,30" into values. Returns false if it is malformed. */
+bool parseSweepList( const std::string &text, std::vector<int> *values );
+bool parseSweepList( const std::string &text, std::vector<float> *values );
+
+/** Run the sweep on network with at most maxEdges links per solution and write the rows to
+	filename. Nmax and nbrAnts fill the lists of the sweep that are empty. */
+int acoSweep( Graph *network, const AcoSweep &sweep, int Nmax, int nbrAnts, int maxEdges,
+			  const std::string &filename );
+
+
+#endif
@@ -0,0 +1,127 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include <iostream>
+#include "threadpool.h"
+#include "montecarlo.h"
+
+
+/** Set in the threads while they run a loop body, nested loops then run serially. */
+static thread_local bool insideLoop = false;
+
+
+ThreadPool::ThreadPool( int threads ) : task(0), taskSize(0), nextIndex(0), active(0), generation(0), stopping(false)
+{
+	if ( threads < 1 )
+		threads = defaultThreadCount();
+	nbrThreads = threads;
+	for ( int w=1; w<nbrThreads; ++w )
+		workers.push_back( std::thread( &ThreadPool::workerLoop, this, w ) );
+}
+
+bool ThreadPool::insideParallelFor()
+{
+	return insideLoop;
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		stopping = true;
+	}
+	wake.notify_all();
+	for ( size_t i=0; i<workers.size(); ++i )
+		workers[i].join();
+}
+
+void ThreadPool::parallelFor( long long n, const std::function<void( long long, int )> &f )
+{
+	if ( n <= 0 )
+		return;
+	if ( insideLoop || workers.empty() || n == 1 )
+	{
+		for ( long long i=0; i<n; ++i )
+			f( i, 0 );
+		return;
+	}
+
+	std::lock_guard<std::mutex> run( runMutex );
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		task = &f;
+		taskSize = n;
+		nextIndex = 0;
+		active = workers.size();
+		++generation;
+	}
+	wake.notify_all();
+
+	runTasks( 0 );
+
+	std::unique_lock<std::mutex> lock( mutex );
+	done.wait( lock, [this] {return active == 0;} );
+	task = 0;
+}
+
+void ThreadPool::runTasks( int worker )
+{
+	insideLoop = true;
+	long long i;
+	while ( (i = nextIndex++) < taskSize )
+		(*task)( i, worker );
+	insideLoop = false;
+}
+
+void ThreadPool::workerLoop( int worker )
+{
+	unsigned int seen = 0;
+	while ( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			wake.wait( lock, [&] {return stopping || generation != seen;} );
+			if ( stopping )
+				return;
+			seen = generation;
+		}
+
+		runTasks( worker );
+
+		std::lock_guard<std::mutex> lock( mutex );
+		if ( --active == 0 )
+			done.notify_all();
+	}
+}
+
+
+Progress::Progress( const std::string &label, long long _total, bool _quiet )
+	: total(_total), quiet(_quiet), doneItems(0), printed(-1)
+{
+	if ( !quiet )
+		std::cout << label << ": " << std::flush;
+}
+
+void Progress::advance( long long n )
+{
+	long long d = (doneItems += n);
+	if ( quiet || total <= 0 )
+		return;
+
+	int percent = (int)(100*d/total);
+	std::lock_guard<std::mutex> lock( printMutex );
+	if ( percent > printed )
+	{
+		printed = percent;
+		std::cout << percent << " " << std::flush;
+	}
+}
+
+void Progress::finish()
+{
+	if ( !quiet )
+		std::cout << std::endl;
+}
@@ -0,0 +1,86 @@
+/** @file threadpool.h
+
+	A fixed set of worker threads running parallel loops, and a progress counter they can share.
+
+	parallelFor hands out the indices of a loop one at a time from a shared counter, so a thread
+	that is done with a cheap index takes the next one while the others are busy. The calling
+	thread works as worker 0. A parallelFor started from inside a loop body runs serially on the
+	calling thread, which makes it safe to call functions that are themselves parallel.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <functional>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+class ThreadPool
+{
+public:
+	/** Start a pool of threads threads including the calling one, 0 means one per core. */
+	ThreadPool( int threads=0 );
+	~ThreadPool();
+
+	/** Number of threads working in parallelFor, including the calling thread. */
+	int getThreads() const {return nbrThreads;};
+
+	/** True in the body of a parallelFor of any pool, where further parallel loops run serially. */
+	static bool insideParallelFor();
+
+	/** Call f( i, worker ) for i=0..n-1 and return when all calls are done.
+		worker is in 0..getThreads()-1 and no two calls with the same worker run at the same time,
+		use it to pick per-thread buffers. */
+	void parallelFor( long long n, const std::function<void( long long, int )> &f );
+
+private:
+	void workerLoop( int worker );
+	void runTasks( int worker );
+
+	int nbrThreads;
+	std::vector<std::thread> workers;
+
+	std::mutex runMutex;			//!< One loop at a time
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void( long long, int )> *task;
+	long long taskSize;
+	std::atomic<long long> nextIndex;
+	int active;						//!< Workers still running the current loop
+	unsigned int generation;		//!< Incremented for every new loop
+	bool stopping;
+};
+
+
+/** Counts finished work items from any number of threads and prints the percentage done. */
+class Progress
+{
+public:
+	/** Print label and then the percentage as total items get done. Nothing is printed if quiet. */
+	Progress( const std::string &label, long long total, bool quiet=false );
+
+	/** Mark n more items as done. Thread safe. */
+	void advance( long long n=1 );
+	/** End the line of output. */
+	void finish();
+
+private:
+	long long total;
+	bool quiet;
+	std::atomic<long long> doneItems;
+	std::mutex printMutex;
+	int printed;		//!< Last percentage printed
+};
+
+
+#endif
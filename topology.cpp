@@ -0,0 +1,48 @@
+/*
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+*/
+
+#include "topology.h"
+
+
+void Topology::assign( int _nbrNodes, int nbrEdges, const int *_ends, const int *_offsets,
+						const int *_neighbors, const int *_adjEdges )
+{
+	nbrNodes = _nbrNodes;
+	ends.assign( _ends, _ends+2*nbrEdges );
+	ids.resize( nbrEdges );
+	for ( int k=0; k<nbrEdges; ++k )
+		ids[k] = k;
+	offsets.assign( _offsets, _offsets+nbrNodes+1 );
+	neighbors.assign( _neighbors, _neighbors+2*nbrEdges );
+	adjEdges.assign( _adjEdges, _adjEdges+2*nbrEdges );
+}
+
+void Topology::build( int _nbrNodes, const std::vector<int> &_ends, const std::vector<int> &_ids )
+{
+	nbrNodes = _nbrNodes;
+	ends = _ends;
+	ids = _ids;
+	int nbrEdges = ids.size();
+
+	// Count the degree of every node, then turn the counts into offsets
+	offsets.assign( nbrNodes+1, 0 );
+	for ( int k=0; k<2*nbrEdges; ++k )
+		++offsets[ ends[k]+1 ];
+	for ( int n=0; n<nbrNodes; ++n )
+		offsets[n+1] += offsets[n];
+
+	neighbors.resize( 2*nbrEdges );
+	adjEdges.resize( 2*nbrEdges );
+	std::vector<int> fill( offsets.begin(), offsets.end()-1 );
+	for ( int k=0; k<nbrEdges; ++k )
+	{
+		int a = ends[2*k], b = ends[2*k+1];
+		neighbors[ fill[a] ] = b;
+		adjEdges[ fill[a]++ ] = k;
+		neighbors[ fill[b] ] = a;
+		adjEdges[ fill[b]++ ] = k;
+	}
+}
@@ -0,0 +1,58 @@
+/** @file topology.h
+
+	Compressed sparse row (CSR) snapshot of a network.
+
+	The neighbors of node n are neighbors[offsets[n]] ... neighbors[offsets[n+1]-1] and
+	the edge leading to neighbor j is adjEdges[j]. Edges are numbered 0..E-1 in the order
+	they were given, edge k connects ends[2k] and ends[2k+1]. All arrays are contiguous,
+	which is what the simulation kernels iterate over instead of the Edge objects.
+
+	Copyright (c) 2010 Anders Bennehag
+	Licensed under the MIT license
+	http://www.opensource.org/licenses/mit-license.php
+ */
+
+#ifndef TOPOLOGY_H_
+#define TOPOLOGY_H_
+
+#include <vector>
+
+
+class Topology
+{
+public:
+	/** Build the snapshot of nbrNodes nodes and the edges ends[2k]-ends[2k+1].
+		ids[k] is the id of edge k in the network it was taken from. */
+	void build( int nbrNodes, const std::vector<int> &ends, const std::vector<int> &ids );
+	/** Copy a snapshot that is already built, of nbrEdges edges with the ids 0..nbrEdges-1. */
+	void assign( int nbrNodes, int nbrEdges, const int *ends, const int *offsets, const int *neighbors, const int *adjEdges );
+
+	int getNbrNodes() const {return nbrNodes;};
+	int getNbrEdges() const {return ids.size();};
+
+	/** The two endpoints of edge k are getEnds()[2k] and getEnds()[2k+1]. */
+	const int* getEnds() const {return ends.data();};
+	/** Id of edge k in the original network. */
+	int getEdgeId( int k ) const {return ids[k];};
+
+	/** Neighbors of n are at getNeighbors()[getOffset(n)] up to getNeighbors()[getOffset(n+1)-1]. */
+	int getOffset( int n ) const {return offsets[n];};
+	/** All nbrNodes+1 offsets */
+	const int* getOffsets() const {return offsets.data();};
+	const int* getNeighbors() const {return neighbors.data();};
+	/** The edge leading to each entry of getNeighbors(). */
+	const int* getAdjEdges() const {return adjEdges.data();};
+
+	Topology() : nbrNodes(0) {};
+
+private:
+	int nbrNodes;
+	std::vector<int> offsets;
+	std::vector<int> neighbors;
+	std::vector<int> adjEdges;
+	std::vector<int> ends;
+	std::vector<int> ids;
+};
+
+
+#endif